@@ -9,6 +9,8 @@
 static uint8_t low =  (NATURAL_FREQ / DESIRED_FREQ) & LOWER_MASK;
 static uint8_t high =  ((NATURAL_FREQ / DESIRED_FREQ) & UPPER_MASK) >> 8; /* Shift 8 to get it into lower 8 bits */
 
+static process_t boot_process; /* current_process before the first execute, gives its stack to the first shell */
+
 /* init_PIT()
  * Description: Initialize the PIT by setting the mode and intializing the counter vals for PIT to interrput at 10 ms intervals .
  *              Inspired by OSDev.
@@ -20,7 +22,7 @@ static uint8_t high =  ((NATURAL_FREQ / DESIRED_FREQ) & UPPER_MASK) >> 8; /* Shi
 void init_PIT() {
     total_processes = 0;                      /* there are no intial processes                                  */
     total_base = 0;                           /* there are no intial base shells                                */
-    current_process = &processes[0];          /* the first process is the first element in global process array */
+    current_process = &boot_process;          /* stands in for a process until the first shell is executed      */
     current_process->next = current_process;  /* create the circular linked list                                */
     pid = 0;                                  /* the first pid will be 0                                        */
     outb(PIT_ICW0, PIT_CMD_PORT);             /* init the PIT with the command words and counter values         */
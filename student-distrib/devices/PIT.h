@@ -7,7 +7,6 @@
 #define PIT_ICW0 0x36
 #define DESIRED_FREQ 100
 #define NATURAL_FREQ 1193182
-#define MAX_PROCESSES 6
 #define LOWER_MASK 0x00FF
 #define UPPER_MASK 0xFF00
 
@@ -0,0 +1,180 @@
+#include "ata.h"
+#include "../lib.h"
+
+static uint32_t sectors;    /* size of the swap disk, 0 if there is none */
+
+/* ata_delay()
+ * Description: Waits the 400 ns a drive needs to put its status on the
+ *              bus after a drive select or a command, by reading the
+ *              alternate status four times. Inspired by OSDev.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+static void ata_delay() {
+    inb(ATA_CONTROL);
+    inb(ATA_CONTROL);
+    inb(ATA_CONTROL);
+    inb(ATA_CONTROL);
+}
+
+/* ata_wait()
+ * Description: Polls the drive until it is no longer busy and, if asked,
+ *              has data for the host or wants data from it.
+ * Inputs: drq - 1 to wait for DRQ as well
+ * Outputs: none
+ * Returns: 0 once ready, -1 on a drive error or timeout
+ * Side Effects: None
+ */
+static int32_t ata_wait(uint32_t drq) {
+    uint32_t status, polls;
+
+    for(polls = 0; polls < ATA_TIMEOUT; polls++) {
+        status = inb(ATA_STATUS);
+        if(status & ATA_SR_BSY) {
+            continue;
+        }
+        if(status & (ATA_SR_ERR | ATA_SR_DF)) {
+            return -1;
+        }
+        if(!drq || (status & ATA_SR_DRQ)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* ata_command()
+ * Description: Selects the swap disk and issues a 28 bit LBA command.
+ * Inputs: cmd - command byte
+ *         lba - first sector
+ *         count - sectors, 1 to ATA_MAX_COUNT
+ * Outputs: none
+ * Returns: 0 on success, -1 if the drive doesn't become ready
+ * Side Effects: None
+ */
+static int32_t ata_command(uint32_t cmd, uint32_t lba, uint32_t count) {
+    if(ata_wait(0) == -1) {
+        return -1;
+    }
+    outb(ATA_SLAVE_LBA | ((lba >> 24) & 0x0F), ATA_DRIVE);
+    ata_delay();
+    outb(count & 0xFF, ATA_COUNT);
+    outb(lba & 0xFF, ATA_LBA_LOW);
+    outb((lba >> 8) & 0xFF, ATA_LBA_MID);
+    outb((lba >> 16) & 0xFF, ATA_LBA_HIGH);
+    outb(cmd, ATA_STATUS);
+    ata_delay();
+    return 0;
+}
+
+/* init_ata()
+ * Description: Looks for the swap disk with IDENTIFY and reads its size.
+ *              The drive is polled, so its IRQ is turned off. Inspired by
+ *              OSDev.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void init_ata() {
+    uint16_t id[ATA_SECTOR_SIZE / 2];
+    uint32_t i;
+
+    sectors = 0;
+    outb(ATA_NIEN, ATA_CONTROL);
+    outb(ATA_SLAVE_LBA, ATA_DRIVE);
+    ata_delay();
+    outb(0, ATA_COUNT);
+    outb(0, ATA_LBA_LOW);
+    outb(0, ATA_LBA_MID);
+    outb(0, ATA_LBA_HIGH);
+    outb(ATA_CMD_IDENTIFY, ATA_STATUS);
+    ata_delay();
+
+    /* a floating bus reads 0xFF, a missing drive 0 */
+    i = inb(ATA_STATUS);
+    if(i == 0 || i == 0xFF) {
+        return;
+    }
+    if(ata_wait(0) == -1) {
+        return;
+    }
+    /* ATAPI and SATA devices answer with a signature instead of data */
+    if(inb(ATA_LBA_MID) != 0 || inb(ATA_LBA_HIGH) != 0 || ata_wait(1) == -1) {
+        return;
+    }
+    for(i = 0; i < ATA_SECTOR_SIZE / 2; i++) {
+        id[i] = inw(ATA_DATA);
+    }
+    sectors = id[ATA_ID_LBA28] | (id[ATA_ID_LBA28 + 1] << 16);
+}
+
+/* ata_sectors()
+ * Description: Gives the size of the swap disk.
+ * Inputs: none
+ * Outputs: none
+ * Returns: sectors on the disk, 0 if init_ata found none
+ * Side Effects: None
+ */
+uint32_t ata_sectors() {
+    return sectors;
+}
+
+/* ata_read()
+ * Description: Reads sectors of the swap disk with polled PIO.
+ * Inputs: lba - first sector
+ *         count - sectors to read, 1 to ATA_MAX_COUNT
+ *         buf - filled with count * ATA_SECTOR_SIZE bytes
+ * Outputs: none
+ * Returns: 0 on success, -1 on bad arguments or a drive error
+ * Side Effects: Busy waits on the drive
+ */
+int32_t ata_read(uint32_t lba, uint32_t count, void * buf) {
+    uint16_t * words = (uint16_t *) buf;
+    uint32_t i;
+
+    if(count == 0 || count > ATA_MAX_COUNT || lba + count > sectors ||
+       ata_command(ATA_CMD_READ, lba, count) == -1) {
+        return -1;
+    }
+    while(count-- > 0) {
+        if(ata_wait(1) == -1) {
+            return -1;
+        }
+        for(i = 0; i < ATA_SECTOR_SIZE / 2; i++) {
+            *words++ = inw(ATA_DATA);
+        }
+    }
+    return 0;
+}
+
+/* ata_write()
+ * Description: Writes sectors of the swap disk with polled PIO. Swap
+ *              doesn't outlive a boot, so the drive's cache isn't flushed.
+ * Inputs: lba - first sector
+ *         count - sectors to write, 1 to ATA_MAX_COUNT
+ *         buf - count * ATA_SECTOR_SIZE bytes to write
+ * Outputs: none
+ * Returns: 0 on success, -1 on bad arguments or a drive error
+ * Side Effects: Busy waits on the drive
+ */
+int32_t ata_write(uint32_t lba, uint32_t count, const void * buf) {
+    const uint16_t * words = (const uint16_t *) buf;
+    uint32_t i;
+
+    if(count == 0 || count > ATA_MAX_COUNT || lba + count > sectors ||
+       ata_command(ATA_CMD_WRITE, lba, count) == -1) {
+        return -1;
+    }
+    while(count-- > 0) {
+        if(ata_wait(1) == -1) {
+            return -1;
+        }
+        for(i = 0; i < ATA_SECTOR_SIZE / 2; i++) {
+            outw(*words++, ATA_DATA);
+        }
+    }
+    return ata_wait(0);
+}
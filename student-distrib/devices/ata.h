@@ -0,0 +1,40 @@
+#ifndef ATA_H
+#define ATA_H
+
+#include "../types.h"
+
+/* The swap disk is the slave on the primary ATA bus: QEMU attaches it with
+ * "-hdb swap.img" (any size, "qemu-img create swap.img 64M"). The master is
+ * the boot disk and is never touched. */
+#define ATA_DATA        0x1F0   /* 16 bit data register                        */
+#define ATA_ERROR       0x1F1
+#define ATA_COUNT       0x1F2   /* sectors to transfer                         */
+#define ATA_LBA_LOW     0x1F3
+#define ATA_LBA_MID     0x1F4
+#define ATA_LBA_HIGH    0x1F5
+#define ATA_DRIVE       0x1F6   /* drive select and LBA bits 24-27             */
+#define ATA_STATUS      0x1F7   /* status when read, command when written      */
+#define ATA_CONTROL     0x3F6   /* alternate status when read                  */
+
+#define ATA_SLAVE_LBA   0xF0    /* drive register: LBA addressing, slave drive */
+#define ATA_NIEN        0x02    /* control register: the drive raises no IRQ   */
+#define ATA_CMD_READ    0x20    /* READ SECTORS, 28 bit LBA                    */
+#define ATA_CMD_WRITE   0x30    /* WRITE SECTORS, 28 bit LBA                   */
+#define ATA_CMD_IDENTIFY 0xEC
+
+#define ATA_SR_ERR      0x01
+#define ATA_SR_DRQ      0x08
+#define ATA_SR_DF       0x20
+#define ATA_SR_BSY      0x80
+
+#define ATA_SECTOR_SIZE 512
+#define ATA_MAX_COUNT   256     /* sectors one command moves, a count of 0 means 256 */
+#define ATA_ID_LBA28    60      /* IDENTIFY words 60-61: sectors reachable with 28 bit LBA */
+#define ATA_TIMEOUT     1000000 /* status polls before a drive is given up on */
+
+void init_ata();
+uint32_t ata_sectors();
+int32_t ata_read(uint32_t lba, uint32_t count, void * buf);
+int32_t ata_write(uint32_t lba, uint32_t count, const void * buf);
+
+#endif
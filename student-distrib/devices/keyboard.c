@@ -1,6 +1,7 @@
 #include "keyboard.h"
 #include "../lib.h"
 #include "../schedule.h"
+#include "../filesystem.h"
 
 /* keyboard_keys associates SHIFT,CTRL,CAPS,ALT states with the printable characters during those states */
 static uint8_t keyboard_keys[STATES][NUM_KEYS] = {
@@ -135,6 +136,15 @@ void keyboard_handler() {
                 break;
             }
             goto RET;
+        case S:
+            if(CTRL) {
+                /* send the filesystem, including anything written to it, out of COM1 */
+                fs_dump_serial();
+            }
+            else {
+                break;
+            }
+            goto RET;
         case ENTER:
             kb_putc('\n');
             kb_buff[buff_idx] = '\n';
@@ -25,6 +25,7 @@
 #define ALT_PRESSED   0x38
 #define ALT_RELEASED  0xB8
 #define L  0x26
+#define S  0x1F
 #define F1 0x3B
 #define F2 0x3C
 #define F3 0x3D
@@ -88,7 +88,9 @@ int32_t rtc_close(int32_t fd) {
  */
 int32_t rtc_read(int32_t fd, void * buf, int32_t nbytes) {
 	current_process->terminal->term_rtc_flag = SET;
-	while(current_process->terminal->term_rtc_flag);
+	while(current_process->terminal->term_rtc_flag) {
+		idle();
+	}
 	return 0;
 }
 
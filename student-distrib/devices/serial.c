@@ -0,0 +1,49 @@
+#include "serial.h"
+#include "../lib.h"
+
+/* init_serial()
+ * Description: Initialize COM1 for polled output at 115200 8N1. The port
+ *              never raises interrupts, so no IRQ line is unmasked.
+ *              Inspired by OSDev.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void init_serial() {
+    outb(0x00, SERIAL_IER);                   /* Disable UART interrupts                  */
+    outb(SERIAL_DLAB, SERIAL_LCR);            /* Set DLAB to program the baud divisor     */
+    outb(SERIAL_DIVISOR & 0xFF, SERIAL_DATA); /* Divisor low byte                         */
+    outb(SERIAL_DIVISOR >> 8, SERIAL_IER);    /* Divisor high byte                        */
+    outb(SERIAL_8N1, SERIAL_LCR);             /* Clear DLAB, 8 bits no parity one stop    */
+    outb(SERIAL_FIFO_ON, SERIAL_FCR);
+    outb(SERIAL_MCR_ON, SERIAL_MCR);
+}
+
+/* serial_putc()
+ * Description: Sends one byte out of COM1, waiting for the transmitter to be free.
+ * Inputs: c - byte to send
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void serial_putc(uint8_t c) {
+    while((inb(SERIAL_LSR) & SERIAL_THR_EMPTY) == 0);
+    outb(c, SERIAL_DATA);
+}
+
+/* serial_write()
+ * Description: Sends a buffer out of COM1 byte by byte. Data is sent raw,
+ *              without translating newlines, so binary data survives.
+ * Inputs: buf - bytes to send
+ *         nbytes - number of bytes to send
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void serial_write(const uint8_t * buf, uint32_t nbytes) {
+    uint32_t i;
+    for(i = 0; i < nbytes; i++) {
+        serial_putc(buf[i]);
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "../types.h"
+
+#define COM1_PORT 0x3F8
+#define SERIAL_DATA (COM1_PORT + 0)     /* transmit holding register, divisor low byte when DLAB is set  */
+#define SERIAL_IER (COM1_PORT + 1)      /* interrupt enable register, divisor high byte when DLAB is set */
+#define SERIAL_FCR (COM1_PORT + 2)      /* FIFO control register                                         */
+#define SERIAL_LCR (COM1_PORT + 3)      /* line control register                                         */
+#define SERIAL_MCR (COM1_PORT + 4)      /* modem control register                                        */
+#define SERIAL_LSR (COM1_PORT + 5)      /* line status register                                          */
+#define SERIAL_DLAB 0x80
+#define SERIAL_8N1 0x03                 /* 8 data bits, no parity, 1 stop bit */
+#define SERIAL_DIVISOR 1                /* 115200 baud                        */
+#define SERIAL_FIFO_ON 0xC7             /* enable and clear FIFOs, 14 byte threshold */
+#define SERIAL_MCR_ON 0x03              /* DTR and RTS, no interrupts                */
+#define SERIAL_THR_EMPTY 0x20
+
+extern void init_serial();
+void serial_putc(uint8_t c);
+void serial_write(const uint8_t * buf, uint32_t nbytes);
+
+#endif
@@ -1,13 +1,246 @@
 #include "filesystem.h"
 #include "lib.h"
-//#include "syscalls.h"
+#include "interrupts/syscalls.h"
+#include "devices/serial.h"
+#include "lz4.h"
+#include "page.h"
+#include "mmap.h"
 
 static bootblock * boot_block;  /* points to the bootblock in memory     */
 static datablock * data_blocks; /* points to first data block in memory  */
-static int count = 0;           /* used to make sure successive calls to read_directory returns 0 once it exceeds num of files */
+static dentry_index_t dentry_index; /* name -> dentry lookup table, built once in init_fs */
+static uint32_t block_bitmap[FS_MAX_BLOCKS / BITS_PER_WORD]; /* bit set for every data block in use */
+static uint32_t inode_bitmap[FS_MAX_INODES / BITS_PER_WORD]; /* bit set for every inode a file owns  */
+static uint32_t max_blocks;     /* data blocks that fit below FS_MEM_LIMIT */
+static uint32_t free_blocks;    /* clear bits in block_bitmap below max_blocks */
+static uint32_t num_direct;     /* data_block[] entries that point straight at data, set by the image format */
+static uint32_t max_file_bytes; /* largest file the image format can describe */
+static uint32_t lz4_bitmap[FS_MAX_INODES / BITS_PER_WORD];   /* bit set for every compressed inode    */
+static lz4_slot_t lz4_cache[LZ4_CACHE_SLOTS]; /* recently decompressed chunks */
+static uint8_t lz4_in[BLOCK_SIZE];  /* compressed chunk gathered from its data blocks */
+static uint32_t lz4_clock;          /* bumped on every cache hit or fill */
+static uint32_t lz4_hits;
+static uint32_t lz4_misses;
+
+/* dentry_hash()
+ * Description: FNV-1a hash of a file name. Names are at most MAX_FILE_NAME_LEN
+ *              characters and are not NUL terminated when they use all of them.
+ * Inputs: fname - file name to hash
+ * Outputs: none
+ * Returns: slot in the dentry index to start probing at
+ * Side Effects: None
+ */
+static uint32_t dentry_hash(const uint8_t * fname) {
+    uint32_t hash = 2166136261U; /* FNV offset basis */
+    int i;
+    for(i = 0; i < MAX_FILE_NAME_LEN && fname[i] != '\0'; i++) {
+        hash ^= fname[i];
+        hash *= 16777619U;       /* FNV prime */
+    }
+    return hash & (DENTRY_HASH_SIZE - 1);
+}
+
+/* bit_test()
+ * Description: Checks one bit of a bitmap.
+ * Inputs: map - bitmap
+ *         bit - bit to check
+ * Outputs: none
+ * Returns: nonzero if the bit is set
+ * Side Effects: None
+ */
+static uint32_t bit_test(const uint32_t * map, uint32_t bit) {
+    return map[bit / BITS_PER_WORD] & (1 << (bit % BITS_PER_WORD));
+}
+
+/* bit_set()
+ * Description: Sets one bit of a bitmap.
+ * Inputs: map - bitmap
+ *         bit - bit to set
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+static void bit_set(uint32_t * map, uint32_t bit) {
+    map[bit / BITS_PER_WORD] |= 1 << (bit % BITS_PER_WORD);
+}
+
+/* fs_max_entries()
+ * Description: Number of directory entries a boot block has room for: the
+ *              ones in the boot block itself plus, for v2 images, the ones
+ *              in its directory blocks.
+ * Inputs: boot - boot block of the image
+ * Outputs: none
+ * Returns: directory capacity in entries
+ * Side Effects: None
+ */
+uint32_t fs_max_entries(const bootblock * boot) {
+    if(boot->ext.magic != FS_V2_MAGIC || boot->ext.dir_blocks > MAX_DIR_BLOCKS) {
+        return NUM_DENTRIES;
+    }
+    return NUM_DENTRIES + boot->ext.dir_blocks * DENTRIES_PER_BLOCK;
+}
+
+/* fs_dentry()
+ * Description: Finds a directory entry of an image. The first NUM_DENTRIES
+ *              live in the boot block, the rest in the v2 directory blocks.
+ * Inputs: boot - boot block of the image
+ *         entry - index of the entry, less than fs_max_entries(boot)
+ * Outputs: none
+ * Returns: pointer to the entry
+ * Side Effects: None
+ */
+static dentry_t * fs_dentry(const bootblock * boot, uint32_t entry) {
+    if(entry < NUM_DENTRIES) {
+        return (dentry_t *) &(boot->entries[entry]);
+    }
+    entry -= NUM_DENTRIES;
+    /* data blocks of this image start after the boot block and its inodes */
+    datablock * blocks = (datablock *) boot + 1 + boot->num_inodes;
+    return (dentry_t *) blocks[boot->ext.dir_block[entry / DENTRIES_PER_BLOCK]].data + entry % DENTRIES_PER_BLOCK;
+}
+
+/* mark_block()
+ * Description: Marks a data block used in the free-block bitmap.
+ * Inputs: block - data block number
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+static void mark_block(uint32_t block) {
+    if(block < max_blocks && !bit_test(block_bitmap, block)) {
+        bit_set(block_bitmap, block);
+        free_blocks--;
+    }
+}
+
+/* take_block()
+ * Description: Claims the lowest free data block and zeroes it.
+ * Inputs: slot - where to store the block number
+ * Outputs: none
+ * Returns: 0 on success, -1 if the image is full
+ * Side Effects: Grows num_blocks in the boot block when the image spills past its old end
+ */
+static int32_t take_block(uint32_t * slot) {
+    uint32_t block;
+    for(block = 0; block < max_blocks && bit_test(block_bitmap, block); block++);
+    if(block == max_blocks) {
+        return -1;
+    }
+    mark_block(block);
+    memset(data_blocks[block].data, 0, BLOCK_SIZE);
+    if(block >= boot_block->num_blocks) {
+        boot_block->num_blocks = block + 1;
+    }
+    *slot = block;
+    return 0;
+}
+
+/* block_slot()
+ * Description: Finds the entry holding the data block number of one block
+ *              of a file: data_block[] itself for the first num_direct
+ *              blocks, then the single and double indirect blocks of v2
+ *              images. With alloc set, indirect blocks are created when
+ *              block is the first one they cover, which is only correct
+ *              when appending blocks to the file in order.
+ * Inputs: inode_block - inode of the file
+ *         block - index of the block within the file
+ *         alloc - nonzero to create missing indirect blocks
+ * Outputs: none
+ * Returns: pointer to the block number, NULL if an indirect block could not be allocated
+ * Side Effects: None
+ */
+static inline uint32_t * block_slot(inode * inode_block, uint32_t block, uint32_t alloc) {
+    uint32_t * ptrs;
+    /* small files never get past this test */
+    if(block < num_direct) {
+        return &(inode_block->data_block[block]);
+    }
+    block -= num_direct;
+    if(block < PTRS_PER_BLOCK) {
+        if(alloc && block == 0 && take_block(&(inode_block->data_block[SINGLE_INDIRECT])) == -1) {
+            return NULL;
+        }
+        return (uint32_t *) data_blocks[inode_block->data_block[SINGLE_INDIRECT]].data + block;
+    }
+    block -= PTRS_PER_BLOCK;
+    if(alloc && block == 0 && take_block(&(inode_block->data_block[DOUBLE_INDIRECT])) == -1) {
+        return NULL;
+    }
+    ptrs = (uint32_t *) data_blocks[inode_block->data_block[DOUBLE_INDIRECT]].data + block / PTRS_PER_BLOCK;
+    if(alloc && block % PTRS_PER_BLOCK == 0 && take_block(ptrs) == -1) {
+        return NULL;
+    }
+    return (uint32_t *) data_blocks[*ptrs].data + block % PTRS_PER_BLOCK;
+}
+
+/* read_stored()
+ * Description: Copies bytes exactly as they are stored in a file's data
+ *              blocks, whole spans of a block at a time. For compressed
+ *              files this is the LZ4 stream, not the file contents.
+ * Inputs: inode_block - inode of the file
+ *         offset - offset into the stored bytes
+ *         buf - buffer to fill
+ *         length - number of bytes to copy, the caller keeps it in range
+ * Outputs: none
+ * Returns: number of bytes copied
+ * Side Effects: None
+ */
+static uint32_t read_stored(inode * inode_block, uint32_t offset, uint8_t * buf, uint32_t length) {
+    uint32_t block = offset / BLOCK_SIZE;    /* flooring offset / BLOCK_SIZE gives which block we want to start reading in*/
+    uint32_t data_idx = offset % BLOCK_SIZE; /* the remaining of ^ is how far into the block we want to start reading (so the data) */
+    uint32_t buff_idx = 0;                   /* fill user buffer starting from 0 */
+    uint32_t chunk;                          /* bytes copied out of the current block */
+
+    /* copy a block at a time: the first chunk is the unaligned head of the read, every
+     * chunk after it starts on a block boundary and the last one may stop short of the end */
+    while(length) {
+        chunk = BLOCK_SIZE - data_idx;
+        if(chunk > length) {
+            chunk = length;
+        }
+        memcpy(buf + buff_idx, data_blocks[*block_slot(inode_block, block, 0)].data + data_idx, chunk);
+        length   -= chunk;
+        buff_idx += chunk;
+        block++;
+        data_idx = 0;
+    }
+    return buff_idx;
+}
+
+/* fs_compressed()
+ * Description: Checks whether a file is stored LZ4 compressed.
+ * Inputs: inode_idx - index of the file's inode
+ * Outputs: none
+ * Returns: nonzero if it is
+ * Side Effects: None
+ */
+uint32_t fs_compressed(uint32_t inode_idx) {
+    return inode_idx < FS_MAX_INODES && bit_test(lz4_bitmap, inode_idx);
+}
+
+/* file_blocks()
+ * Description: Counts the data blocks a file's stored bytes take up. For
+ *              compressed files that comes from the end of the offset
+ *              table, not from the inode length.
+ * Inputs: inode_idx - index of the file's inode
+ * Outputs: none
+ * Returns: number of data blocks
+ * Side Effects: None
+ */
+static uint32_t file_blocks(uint32_t inode_idx) {
+    inode * inode_block = inodes + inode_idx;
+    uint32_t stored = inode_block->length;
+    if(fs_compressed(inode_idx)) {
+        read_stored(inode_block, (stored + BLOCK_SIZE - 1) / BLOCK_SIZE * sizeof(uint32_t), (uint8_t *) &stored, sizeof(stored));
+    }
+    return (stored + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
 
 /* init_fs()
- * Description: Initialize filesystem and adjust pointers to memory.
+ * Description: Initialize filesystem and adjust pointers to memory, detect
+ *              whether the image uses the original or the extended (v2)
+ *              format, then work out which inodes and data blocks are free
+ *              by walking every regular file in the directory.
  * Inputs: none
  * Outputs: none
  * Returns: none
@@ -20,6 +253,222 @@ void init_fs() {
     inodes = (inode *) boot_block + 1; 
     /* datablocks are after number of inodes, + 1 to skip boot_block */
     data_blocks = (datablock * ) FS_START->mod_start + (1 + boot_block->num_inodes); 
+    if(boot_block->ext.magic == FS_V2_MAGIC) {
+        num_direct = NUM_DIRECT_V2;
+        max_file_bytes = 0xFFFFFFFF;
+    }
+    else {
+        num_direct = NUM_DATA_BLOCKS;
+        max_file_bytes = NUM_DATA_BLOCKS * BLOCK_SIZE;
+    }
+    /* index the directory so name lookups don't have to scan every entry */
+    dentry_index_build(&dentry_index, boot_block);
+
+    /* the image can grow into the free memory after the module, up to FS_MEM_LIMIT */
+    if(FS_START->mod_end > FS_MEM_LIMIT) {
+        printf("filesystem image ends past 0x%x, it will be overwritten\n", FS_MEM_LIMIT);
+    }
+    max_blocks = (FS_MEM_LIMIT - (uint32_t) data_blocks) / BLOCK_SIZE;
+    if(max_blocks < boot_block->num_blocks) {
+        max_blocks = boot_block->num_blocks;
+    }
+    /* blocks past the bitmap are never handed out */
+    if(max_blocks > FS_MAX_BLOCKS) {
+        max_blocks = FS_MAX_BLOCKS;
+    }
+
+    uint32_t i, j, num_blocks;
+    inode * inode_block;
+    dentry_t * entry;
+    memset(block_bitmap, 0, sizeof(block_bitmap));
+    memset(inode_bitmap, 0, sizeof(inode_bitmap));
+    memset(lz4_bitmap, 0, sizeof(lz4_bitmap));
+    lz4_cache_flush();
+    free_blocks = max_blocks;
+    /* v2 directory blocks, fs_max_entries is only past NUM_DENTRIES when there are some */
+    for(i = 0; NUM_DENTRIES + i * DENTRIES_PER_BLOCK < fs_max_entries(boot_block); i++) {
+        mark_block(boot_block->ext.dir_block[i]);
+    }
+    for(i = 0; i < boot_block->num_entries && i < fs_max_entries(boot_block); i++) {
+        entry = fs_dentry(boot_block, i);
+        /* rtc and the directory point at inode 0 without owning it */
+        if(entry->f_type != EXEC_TYPE || entry->inode >= boot_block->num_inodes) {
+            continue;
+        }
+        bit_set(inode_bitmap, entry->inode);
+        if(entry->flags & DENTRY_LZ4) {
+            bit_set(lz4_bitmap, entry->inode);
+        }
+        inode_block = inodes + entry->inode;
+        num_blocks = file_blocks(entry->inode);
+        for(j = 0; j < num_blocks; j++) {
+            mark_block(*block_slot(inode_block, j, 0));
+        }
+        /* the indirect blocks are used too */
+        if(num_blocks > num_direct) {
+            mark_block(inode_block->data_block[SINGLE_INDIRECT]);
+        }
+        if(num_blocks > num_direct + PTRS_PER_BLOCK) {
+            mark_block(inode_block->data_block[DOUBLE_INDIRECT]);
+            for(j = 0; j < num_blocks - num_direct - PTRS_PER_BLOCK; j += PTRS_PER_BLOCK) {
+                mark_block(((uint32_t *) data_blocks[inode_block->data_block[DOUBLE_INDIRECT]].data)[j / PTRS_PER_BLOCK]);
+            }
+        }
+    }
+}
+
+/* fs_free_blocks()
+ * Description: Reports how many data blocks are left for writes.
+ * Inputs: none
+ * Outputs: none
+ * Returns: number of free data blocks
+ * Side Effects: None
+ */
+uint32_t fs_free_blocks() {
+    return free_blocks;
+}
+
+/* find_free_run()
+ * Description: Finds count free data blocks in a row, trying the blocks
+ *              starting at hint first so a growing file stays contiguous,
+ *              then the lowest run in the image.
+ * Inputs: hint - preferred first block, usually just past the file's last block
+ *         count - length of the run
+ * Outputs: none
+ * Returns: first block of the run, -1 if there is no run that long
+ * Side Effects: None
+ */
+static int32_t find_free_run(uint32_t hint, uint32_t count) {
+    uint32_t start, len;
+    for(len = 0; len < count && hint + len < max_blocks && !bit_test(block_bitmap, hint + len); len++);
+    if(len == count) {
+        return hint;
+    }
+    /* first fit: len counts the free blocks seen in a row ending at start + len - 1 */
+    len = 0;
+    for(start = 0; start + len < max_blocks; ) {
+        if(bit_test(block_bitmap, start + len)) {
+            start += len + 1;
+            len = 0;
+            continue;
+        }
+        if(++len == count) {
+            return start;
+        }
+    }
+    return -1;
+}
+
+/* alloc_blocks()
+ * Description: Appends count zeroed data blocks to an inode, as one run if
+ *              possible and one block at a time from the lowest free block
+ *              otherwise. Indirect blocks the new blocks need are claimed
+ *              first so they can't land in the middle of the run.
+ * Inputs: inode_block - inode to grow
+ *         have - blocks the inode already uses
+ *         count - blocks to add
+ * Outputs: none
+ * Returns: number of blocks added, less than count when the image is full
+ * Side Effects: Marks the blocks used in block_bitmap, grows num_blocks in
+ *               the boot block when the image spills past its old end
+ */
+static uint32_t alloc_blocks(inode * inode_block, uint32_t have, uint32_t count) {
+    uint32_t added;
+    for(added = 0; added < count; added++) {
+        if(block_slot(inode_block, have + added, 1) == NULL) {
+            count = added;
+            break;
+        }
+    }
+
+    uint32_t hint = (have == 0) ? 0 : *block_slot(inode_block, have - 1, 0) + 1;
+    int32_t run = find_free_run(hint, count);
+    uint32_t * slot;
+
+    for(added = 0; added < count; added++) {
+        slot = block_slot(inode_block, have + added, 0);
+        if(run == -1) {
+            /* no run is long enough, take whatever is free */
+            if(take_block(slot) == -1) {
+                break;
+            }
+            continue;
+        }
+        *slot = run + added;
+        mark_block(*slot);
+        memset(data_blocks[*slot].data, 0, BLOCK_SIZE);
+        if(*slot >= boot_block->num_blocks) {
+            boot_block->num_blocks = *slot + 1;
+        }
+    }
+    return added;
+}
+
+/* dentry_index_build()
+ * Description: Fills a dentry index with every entry of a boot block.
+ * Inputs: index - index to fill
+ *         boot - boot block whose entries get indexed
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Overwrites the old contents of index
+ */
+void dentry_index_build(dentry_index_t * index, const bootblock * boot) {
+    uint32_t i;
+    memset_word(index->slot, DENTRY_HASH_EMPTY, DENTRY_HASH_SIZE);
+    for(i = 0; i < boot->num_entries && i < fs_max_entries(boot); i++) {
+        dentry_index_insert(index, boot, i);
+    }
+}
+
+/* dentry_index_insert()
+ * Description: Adds one directory entry to a dentry index. Must be called
+ *              whenever an entry is added to the boot block so the index
+ *              stays coherent with the directory.
+ * Inputs: index - index to add to
+ *         boot - boot block holding the entry
+ *         entry - index of the entry in boot->entries
+ * Outputs: none
+ * Returns: -1 if the index is full, 0 otherwise
+ * Side Effects: None
+ */
+int32_t dentry_index_insert(dentry_index_t * index, const bootblock * boot, uint32_t entry) {
+    uint32_t slot = dentry_hash(fs_dentry(boot, entry)->f_name);
+    int i;
+    /* linear probing, the table is never more than half full */
+    for(i = 0; i < DENTRY_HASH_SIZE; i++) {
+        if(index->slot[slot] == DENTRY_HASH_EMPTY) {
+            index->slot[slot] = entry;
+            return 0;
+        }
+        slot = (slot + 1) & (DENTRY_HASH_SIZE - 1);
+    }
+    return -1;
+}
+
+/* dentry_index_lookup()
+ * Description: Finds the directory entry with the given name using a dentry index.
+ * Inputs: index - index built over boot
+ *         boot - boot block holding the entries
+ *         fname - name to look up
+ * Outputs: none
+ * Returns: index of the entry in the directory, -1 if there is no such file
+ * Side Effects: None
+ */
+int32_t dentry_index_lookup(const dentry_index_t * index, const bootblock * boot, const uint8_t * fname) {
+    uint32_t slot = dentry_hash(fname);
+    int i;
+    for(i = 0; i < DENTRY_HASH_SIZE; i++) {
+        uint16_t entry = index->slot[slot];
+        /* an empty slot ends the probe chain, so the name isn't in the directory */
+        if(entry == DENTRY_HASH_EMPTY) {
+            return -1;
+        }
+        if(strncmp((const int8_t *) fname, (const int8_t *) fs_dentry(boot, entry)->f_name, MAX_FILE_NAME_LEN) == 0) {
+            return entry;
+        }
+        slot = (slot + 1) & (DENTRY_HASH_SIZE - 1);
+    }
+    return -1;
 }
 
 /* fs_open()
@@ -36,14 +485,14 @@ int32_t fs_open(const uint8_t * filename) {
 }
 
 /* dir_open()
- * Description: Opens the input directory
+ * Description: Opens the input directory. The read position lives in the
+ *              file descriptor's file_pos, which open() starts at 0.
  * Inputs: filename - file name
  * Outputs: none
  * Returns: 0
- * Side Effects: Resets count 0
+ * Side Effects: none
  */
 int32_t dir_open(const uint8_t * filename) {
-    count = 0;
     return 0;
 }
 
@@ -71,16 +520,148 @@ int32_t fs_close(int32_t fd) {
 }
 
 /* fs_write()
- * Description: Does nothing as filesystem is currently read-only.
+ * Description: Writes to file fd of current process at its current position,
+ *              overwriting the data there and growing the file past its end.
  * Inputs: fd - file directory
  *         buf - data to be written to file
  *         nbytes - number of bytes of data to be written
  * Outputs: none
- * Returns: -1 on failure, 0 otherwise
- * Side Effects: None
+ * Returns: number of bytes written, -1 on failure
+ * Side Effects: updates current position in file and its extent map
  */
 int32_t fs_write(int32_t fd, const void * buf, int32_t nbytes) {
-    return -1;
+    file_desc_t * file = get_file(fd);
+    if(file == NULL || nbytes < 0) {
+        return -1;
+    }
+    int32_t written = write_data(file->inode, file->file_pos, (const uint8_t *) buf, nbytes);
+    if(written > 0) {
+        file->file_pos += written;
+        /* the write may have added blocks, so remap the file's runs */
+        build_extents(file->inode, &(file->extents));
+    }
+    return written;
+}
+
+/* fs_create()
+ * Description: Adds an empty regular file to the directory.
+ * Inputs: fname - name of the new file, 1 to MAX_FILE_NAME_LEN characters
+ * Outputs: none
+ * Returns: index of the new entry, -1 if the name is bad or taken, or the
+ *          directory or inode table is full
+ * Side Effects: Claims a free inode and a directory entry, and on v2 images
+ *               a new directory block when the last one is full
+ */
+int32_t fs_create(const uint8_t * fname) {
+    if(fname == NULL) {
+        return -1;
+    }
+    uint32_t length = strlen((const int8_t *) fname);
+    if(length == 0 || length > MAX_FILE_NAME_LEN || dentry_index_lookup(&dentry_index, boot_block, fname) != -1) {
+        return -1;
+    }
+    if(boot_block->num_entries >= fs_max_entries(boot_block)) {
+        /* only v2 images can grow their directory */
+        if(boot_block->ext.magic != FS_V2_MAGIC || boot_block->ext.dir_blocks >= MAX_DIR_BLOCKS
+           || take_block(&(boot_block->ext.dir_block[boot_block->ext.dir_blocks])) == -1) {
+            return -1;
+        }
+        boot_block->ext.dir_blocks++;
+    }
+    uint32_t i;
+    for(i = 0; i < boot_block->num_inodes && i < FS_MAX_INODES && bit_test(inode_bitmap, i); i++);
+    if(i == boot_block->num_inodes || i == FS_MAX_INODES) {
+        return -1;
+    }
+    bit_set(inode_bitmap, i);
+    (inodes + i)->length = 0;
+
+    uint32_t entry = boot_block->num_entries;
+    dentry_t * dentry = fs_dentry(boot_block, entry);
+    memset(dentry, 0, sizeof(dentry_t));
+    memcpy(dentry->f_name, fname, length);
+    dentry->f_type = EXEC_TYPE;
+    dentry->inode = i;
+    /* index the entry before publishing it */
+    dentry_index_insert(&dentry_index, boot_block, entry);
+    boot_block->num_entries++;
+    return entry;
+}
+
+/* write_data()
+ * Description: Copies a buffer into a file given its inode, overwriting the
+ *              blocks the file already has and allocating new ones for the
+ *              part past its end. Writes may start anywhere up to the end of
+ *              the file, so files never have holes.
+ * Inputs: inode_idx - index of inode corresponding to file
+ *         offset - offset into file in bytes
+ *         buf - data to write
+ *         write_length - number of bytes to write
+ * Outputs: none
+ * Returns: number of bytes written, less than write_length if the image
+ *          filled up, -1 on failure or if a process runs or mmaps the file
+ * Side Effects: May grow the file and num_blocks in the boot block. Runs
+ *               with interrupts off, so no process starts the file midway
+ */
+int32_t write_data(uint32_t inode_idx, uint32_t offset, const uint8_t * buf, uint32_t write_length) {
+    uint32_t flags;
+    if(inode_idx >= boot_block->num_inodes || buf == NULL) {
+        return -1;
+    }
+    inode * inode_block = inodes + inode_idx;
+    cli_and_save(flags);
+    /* compressed files are read only, and running programs and mmap map the image's blocks */
+    if(offset > inode_block->length || fs_compressed(inode_idx) || user_image_busy(inode_idx) || vma_maps_inode(inode_idx)) {
+        restore_flags(flags);
+        return -1;
+    }
+    /* stay within what the inode can describe */
+    if(write_length > max_file_bytes - offset) {
+        write_length = max_file_bytes - offset;
+    }
+
+    uint32_t have = (inode_block->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t need = (offset + write_length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if(need > have) {
+        need = have + alloc_blocks(inode_block, have, need - have);
+        /* stop at the last block we could get */
+        if(offset + write_length > need * BLOCK_SIZE) {
+            write_length = need * BLOCK_SIZE - offset;
+        }
+    }
+
+    uint32_t block = offset / BLOCK_SIZE;
+    uint32_t data_idx = offset % BLOCK_SIZE;
+    uint32_t buff_idx = 0;
+    uint32_t chunk;
+    while(buff_idx < write_length) {
+        chunk = BLOCK_SIZE - data_idx;
+        if(chunk > write_length - buff_idx) {
+            chunk = write_length - buff_idx;
+        }
+        memcpy(data_blocks[*block_slot(inode_block, block, 0)].data + data_idx, buf + buff_idx, chunk);
+        buff_idx += chunk;
+        block++;
+        data_idx = 0;
+    }
+    if(offset + buff_idx > inode_block->length) {
+        inode_block->length = offset + buff_idx;
+    }
+    restore_flags(flags);
+    return buff_idx;
+}
+
+/* fs_dump_serial()
+ * Description: Sends the whole image, boot block through the last data
+ *              block, out of COM1 so writes made during a run can be kept.
+ *              Run QEMU with "-serial file:filesys_out.img" to capture it.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Busy waits on the UART for the length of the image
+ */
+void fs_dump_serial() {
+    serial_write((const uint8_t *) boot_block, (1 + boot_block->num_inodes + boot_block->num_blocks) * BLOCK_SIZE);
 }
 
 /* dir_write()
@@ -110,23 +691,17 @@ int32_t read_dentry_by_name(const uint8_t *fname, dentry_t * dentry) {
     if(fname == NULL || dentry == NULL || strlen((const int8_t *) fname) > MAX_FILE_NAME_LEN) {
         return -1;
     }
-    int i = 0;
-    while(i < boot_block->num_entries) {
-        uint32_t length = strlen((const int8_t *) boot_block->entries[i].f_name);
-        length = MAX_FILE_NAME_LEN;
-        /* use string compare to see if directory name and fname are the same, if so copy the data into user dentry */
-        if(strncmp((const int8_t *)fname , (const int8_t *)boot_block->entries[i].f_name, length) == 0) {
-            if(strncmp((const int8_t *)fname , (const int8_t *)boot_block->entries[i].f_name, length) == 0) {
-                strcpy((int8_t *) dentry->f_name, (const int8_t *) fname);
-                dentry->f_name[length] = '\0'; /* terminate the user entry with EOS */
-                dentry->f_type = boot_block->entries[i].f_type;
-                dentry->inode = boot_block->entries[i].inode;
-                return 0;
-            }
-        }
-        i++;
+    /* hash the name instead of comparing it against every entry */
+    int32_t i = dentry_index_lookup(&dentry_index, boot_block, fname);
+    if(i == -1) {
+        return -1;
     }
-    return -1;
+    dentry_t * entry = fs_dentry(boot_block, i);
+    strncpy((int8_t *) dentry->f_name, (const int8_t *) entry->f_name, MAX_FILE_NAME_LEN);
+    dentry->f_type = entry->f_type;
+    dentry->inode = entry->inode;
+    dentry->flags = entry->flags;
+    return 0;
 }
 
 /* read_dentry_by_index()
@@ -139,18 +714,141 @@ int32_t read_dentry_by_name(const uint8_t *fname, dentry_t * dentry) {
  * Side Effects: None
  */
 int32_t read_dentry_by_index (uint32_t index, dentry_t* dentry) {
-    if(index > boot_block->num_entries) { /* ensure index is valid (not greater than num of entries) */
+    if(index >= boot_block->num_entries) { /* ensure index is valid (less than num of entries) */
         return -1;
     }
-    uint32_t length = strlen((const int8_t *) boot_block->entries[index].f_name);
-    /* copy directory entry by accessing boot_block->entries[index] */
-    strcpy((int8_t *) dentry->f_name, (const int8_t *)boot_block->entries[index].f_name);
-    dentry->f_name[length] = '\0';
-    dentry->f_type = boot_block->entries[index].f_type;
-    dentry->inode = boot_block->entries[index].inode;
+    /* the entry is in the boot block or, past NUM_DENTRIES, in a directory block */
+    dentry_t * entry = fs_dentry(boot_block, index);
+    strncpy((int8_t *) dentry->f_name, (const int8_t *) entry->f_name, MAX_FILE_NAME_LEN);
+    dentry->f_type = entry->f_type;
+    dentry->inode = entry->inode;
+    dentry->flags = entry->flags;
     return 0;
 }
 
+/* lz4_cache_flush()
+ * Description: Empties the decompressed chunk cache.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void lz4_cache_flush() {
+    uint32_t i;
+    for(i = 0; i < LZ4_CACHE_SLOTS; i++) {
+        lz4_cache[i].inode = FS_MAX_INODES;
+    }
+}
+
+/* lz4_cache_stats()
+ * Description: Reports how many chunk lookups the cache has served since boot.
+ * Inputs: hits - filled with lookups that found the chunk decompressed already
+ *         misses - filled with lookups that had to decompress it
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void lz4_cache_stats(uint32_t * hits, uint32_t * misses) {
+    *hits = lz4_hits;
+    *misses = lz4_misses;
+}
+
+/* lz4_chunk()
+ * Description: Finds a decompressed chunk of a compressed file in the cache,
+ *              decompressing it into the least recently used slot on a miss.
+ * Inputs: inode_idx - index of the file's inode
+ *         chunk - BLOCK_SIZE sized piece of the file, must be within it
+ * Outputs: none
+ * Returns: the decompressed chunk, NULL if it is corrupt
+ * Side Effects: May evict another chunk
+ */
+static uint8_t * lz4_chunk(uint32_t inode_idx, uint32_t chunk) {
+    inode * inode_block = inodes + inode_idx;
+    lz4_slot_t * slot = &lz4_cache[0];
+    uint32_t i, range[2], size;
+
+    for(i = 0; i < LZ4_CACHE_SLOTS; i++) {
+        if(lz4_cache[i].inode == inode_idx && lz4_cache[i].chunk == chunk) {
+            lz4_hits++;
+            lz4_cache[i].last_used = ++lz4_clock;
+            return lz4_cache[i].data;
+        }
+        if(lz4_cache[i].last_used < slot->last_used) {
+            slot = &lz4_cache[i];
+        }
+    }
+    lz4_misses++;
+
+    /* this chunk's LZ4 block runs from range[0] to range[1] in the stream */
+    read_stored(inode_block, chunk * sizeof(uint32_t), (uint8_t *) range, sizeof(range));
+    size = inode_block->length - chunk * BLOCK_SIZE;
+    if(size > BLOCK_SIZE) {
+        size = BLOCK_SIZE;
+    }
+    if(range[1] < range[0] || range[1] - range[0] > size) {
+        return NULL;
+    }
+    slot->inode = FS_MAX_INODES;
+    if(range[1] - range[0] == size) {
+        /* stored as is, it didn't compress */
+        read_stored(inode_block, range[0], slot->data, size);
+    }
+    else {
+        /* the block may straddle data blocks, so gather it first */
+        read_stored(inode_block, range[0], lz4_in, range[1] - range[0]);
+        if(lz4_decompress(lz4_in, range[1] - range[0], slot->data, size) != (int32_t) size) {
+            return NULL;
+        }
+    }
+    slot->inode = inode_idx;
+    slot->chunk = chunk;
+    slot->last_used = ++lz4_clock;
+    return slot->data;
+}
+
+/* read_lz4()
+ * Description: read_data for compressed files, copying out of decompressed
+ *              chunks. The caller has already clipped the read to the file.
+ * Inputs: inode_idx - index of the file's inode
+ *         offset - offset into the decompressed file
+ *         buf - buffer to fill
+ *         read_length - number of bytes to read
+ * Outputs: none
+ * Returns: number of bytes copied, -1 if the file is corrupt
+ * Side Effects: Fills and evicts chunk cache slots, with interrupts off
+ *               for each chunk
+ */
+static int32_t read_lz4(uint32_t inode_idx, uint32_t offset, uint8_t * buf, uint32_t read_length) {
+    uint32_t chunk = offset / BLOCK_SIZE;
+    uint32_t data_idx = offset % BLOCK_SIZE;
+    uint32_t buff_idx = 0;
+    uint32_t size, flags;
+    uint8_t * data;
+
+    while(read_length) {
+        /* the slot and lz4_in are shared, so no other process may read a
+         * compressed file until the chunk is copied out. A fault on buf
+         * during the copy can, but the slot just used is the last evicted */
+        cli_and_save(flags);
+        data = lz4_chunk(inode_idx, chunk);
+        if(data == NULL) {
+            restore_flags(flags);
+            return -1;
+        }
+        size = BLOCK_SIZE - data_idx;
+        if(size > read_length) {
+            size = read_length;
+        }
+        memcpy(buf + buff_idx, data + data_idx, size);
+        restore_flags(flags);
+        read_length -= size;
+        buff_idx    += size;
+        chunk++;
+        data_idx = 0;
+    }
+    return buff_idx;
+}
+
 /* read_data()
  * Description: Finds and loads the data of a file into a buffer given its inode.
  * Inputs: inode_idx - index of inode corresponding to desired file
@@ -158,7 +856,7 @@ int32_t read_dentry_by_index (uint32_t index, dentry_t* dentry) {
  *         buf - buffer to fill with file data
  *         read_length - number of bytes to read
  * Outputs: none
- * Returns: -1 on failure, 0 otherwise
+ * Returns: number of bytes copied, -1 on failure
  * Side Effects: None
  */
 int32_t read_data (uint32_t inode_idx, uint32_t offset, uint8_t* buf, uint32_t read_length) {
@@ -181,36 +879,155 @@ int32_t read_data (uint32_t inode_idx, uint32_t offset, uint8_t* buf, uint32_t r
         read_length = file_length - offset; 
     }
 
-    uint32_t block = offset / BLOCK_SIZE;    /* flooring offset / BLOCK_SIZE gives which block we want to start reading in*/
-    uint32_t data_idx = offset % BLOCK_SIZE; /* the remaining of ^ is how far into the block we want to start reading (so the data) */
-    uint32_t buff_idx = 0;                   /* fill user buffer starting from 0 */
-    
+    /* compressed files go through the chunk cache */
+    if(fs_compressed(inode_idx)) {
+        return read_lz4(inode_idx, offset, buf, read_length);
+    }
+    return read_stored(inode_block, offset, buf, read_length);
+}
+
+/* file_block()
+ * Description: Finds where one of a file's data blocks sits in the loaded image.
+ * Inputs: inode_idx - index of the file's inode
+ *         block - index of the block within the file
+ * Outputs: none
+ * Returns: address of the data block, NULL if the file has no such block
+ *          or is compressed
+ * Side Effects: None
+ */
+uint8_t * file_block(uint32_t inode_idx, uint32_t block) {
+    if(inode_idx >= boot_block->num_inodes || fs_compressed(inode_idx) || block >= ((inodes + inode_idx)->length + BLOCK_SIZE - 1) / BLOCK_SIZE) {
+        return NULL;
+    }
+    return data_blocks[*block_slot(inodes + inode_idx, block, 0)].data;
+}
+
+/* build_extents()
+ * Description: Collapses an inode's data_block list into runs of consecutive
+ *              block numbers. Files that need more than MAX_EXTENTS runs are
+ *              left uncached and read through the inode instead.
+ * Inputs: inode_idx - index of the inode to map
+ *         map - extent map to fill
+ * Outputs: none
+ * Returns: number of extents, 0 if the file was not cached, -1 on failure
+ * Side Effects: None
+ */
+int32_t build_extents(uint32_t inode_idx, extent_map_t * map) {
+    if(inode_idx >= boot_block->num_inodes || map == NULL) {
+        return -1;
+    }
+    inode * inode_block = inodes + inode_idx;
+    uint32_t num_blocks = (inode_block->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t i, block;
+    extent_t * run = map->run;
+
+    map->count = 0;
+    map->blocks = num_blocks;
+    /* runs of compressed bytes are no use to a reader */
+    if(fs_compressed(inode_idx)) {
+        map->blocks = 0;
+        return 0;
+    }
+    for(i = 0; i < num_blocks; i++) {
+        /* extend the current run if this block follows the last one */
+        block = *block_slot(inode_block, i, 0);
+        if(map->count != 0 && block == run->start + run->length) {
+            run->length++;
+            continue;
+        }
+        if(map->count == MAX_EXTENTS) {
+            map->count = 0;
+            map->blocks = 0;
+            return 0;
+        }
+        if(map->count != 0) {
+            run++;
+        }
+        run->start = block;
+        run->length = 1;
+        map->count++;
+    }
+    return map->count;
+}
+
+/* read_extents()
+ * Description: Same as read_data, but uses an extent map so every run of
+ *              consecutive blocks is copied with a single memcpy and seeking
+ *              to the offset only walks the (at most MAX_EXTENTS) runs.
+ *              Falls back to read_data when the map is empty or the file
+ *              has grown past the blocks it covers.
+ * Inputs: map - extent map built by build_extents for inode_idx
+ *         inode_idx - index of inode corresponding to desired file
+ *         offset - offset into file in bytes
+ *         buf - buffer to fill with file data
+ *         read_length - number of bytes to read
+ * Outputs: none
+ * Returns: number of bytes copied, -1 on failure
+ * Side Effects: None
+ */
+int32_t read_extents(const extent_map_t * map, uint32_t inode_idx, uint32_t offset, uint8_t * buf, uint32_t read_length) {
+    if(map == NULL || map->count == 0) {
+        return read_data(inode_idx, offset, buf, read_length);
+    }
+    if(inode_idx >= boot_block->num_inodes || buf == NULL) {
+        return -1;
+    }
+    uint32_t file_length = (inodes + inode_idx)->length;
+    if(offset >= file_length) {
+        return -1;
+    }
+    if(offset + read_length > file_length) {
+        read_length = file_length - offset;
+    }
+    /* another descriptor may have appended blocks this map doesn't know about */
+    if(offset + read_length > map->blocks * BLOCK_SIZE) {
+        return read_data(inode_idx, offset, buf, read_length);
+    }
+
+    uint32_t block = offset / BLOCK_SIZE;    /* block of the file the read starts in   */
+    uint32_t data_idx = offset % BLOCK_SIZE; /* where in that block the read starts     */
+    uint32_t buff_idx = 0;                   /* bytes copied so far                     */
+    uint32_t chunk;                          /* bytes copied out of the current run     */
+    const extent_t * run = map->run;
+
+    /* skip the runs that end before the starting block */
+    while(block >= run->length) {
+        block -= run->length;
+        run++;
+    }
     while(read_length) {
-        buf[buff_idx] = data_blocks[inode_block->data_block[block]].data[data_idx];
-        read_length --;
-        data_idx    ++;
-        buff_idx    ++;
-        /* once data_idx goes exceeds the size of the block, reset it 0 and go to next block */
-        if(data_idx >= BLOCK_SIZE) {
-            block++;
-            data_idx = 0;
+        /* the rest of this run is contiguous in memory, so copy it in one go */
+        chunk = (run->length - block) * BLOCK_SIZE - data_idx;
+        if(chunk > read_length) {
+            chunk = read_length;
         }
+        memcpy(buf + buff_idx, data_blocks[run->start + block].data + data_idx, chunk);
+        read_length -= chunk;
+        buff_idx    += chunk;
+        run++;
+        block = 0;
+        data_idx = 0;
     }
-    /* buff idx is how many bytes were copied at this point */
-    return buff_idx; 
+    return buff_idx;
 }
 
 /* read_directory()
- * Description: Loads the name of a file given its directory into the input buffer.
+ * Description: Loads the name of the next file in the directory into the input buffer.
  * Inputs: fd - file directory who's name is being loaded
  *         buf - buffer to fill with name
  *         nbytes - number of characters to copy
  * Outputs: none
  * Returns: number of bytes copied, 0 if the number of calls exceeds number of files.
- * Side Effects: None
+ * Side Effects: Advances the descriptor's position by one entry
  */
 int32_t dir_read(int32_t fd, void * buf, int32_t nbytes) {
-    if(buf == 0 || count >= boot_block->num_entries) {
+    file_desc_t * file = get_file(fd);
+    if(file == NULL) {
+        return 0;
+    }
+    /* every descriptor keeps its own position, so two readers don't interfere */
+    uint32_t * cursor = &(file->file_pos);
+    if(buf == 0 || *cursor >= boot_block->num_entries) {
         return 0;
     }
     int bytes_written = nbytes;
@@ -219,12 +1036,56 @@ int32_t dir_read(int32_t fd, void * buf, int32_t nbytes) {
         bytes_written = MAX_FILE_NAME_LEN;
     }
     char * buffer = (char * ) buf;
+    uint8_t * f_name = fs_dentry(boot_block, *cursor)->f_name;
     int i;
     /* Copy name into input buffer */
-    for(i = 0; i < bytes_written && boot_block->entries[count].f_name[i] != '\0'; i++) {
-        buffer[i] =  (boot_block->entries[count].f_name[i]);
+    for(i = 0; i < bytes_written && f_name[i] != '\0'; i++) {
+        buffer[i] =  f_name[i];
     }
     /* update directory position */
-    count++; 
+    (*cursor)++; 
     return i;
 }
+
+/* dir_lseek()
+ * Description: Moves a directory descriptor to another entry, positions count entries.
+ * Inputs: fd - file directory to move
+ *         offset - new position, relative to whence
+ *         whence - SEEK_SET, SEEK_CUR or SEEK_END
+ * Outputs: none
+ * Returns: new position, -1 if it would fall outside the directory
+ * Side Effects: Changes which entry the next dir_read/getdents returns
+ */
+int32_t dir_lseek(int32_t fd, int32_t offset, int32_t whence) {
+    file_desc_t * file = get_file(fd);
+    if(file == NULL) {
+        return -1;
+    }
+    return seek_to(file, offset, whence, boot_block->num_entries);
+}
+
+/* read_dirents()
+ * Description: Fills a buffer with as many directory entries as fit, starting
+ *              at a cursor, including each file's type and length so callers
+ *              don't have to open every file to learn its size.
+ * Inputs: cursor - index of the next entry to return, advanced past the ones copied
+ *         buf - array of entries to fill
+ *         max - number of entries buf has room for
+ * Outputs: none
+ * Returns: number of entries copied, 0 once the directory is exhausted
+ * Side Effects: None
+ */
+int32_t read_dirents(uint32_t * cursor, dirent_t * buf, uint32_t max) {
+    uint32_t copied = 0;
+    dentry_t * entry;
+
+    while(copied < max && *cursor < boot_block->num_entries) {
+        entry = fs_dentry(boot_block, *cursor);
+        memcpy(buf[copied].f_name, entry->f_name, MAX_FILE_NAME_LEN);
+        buf[copied].f_type = entry->f_type;
+        buf[copied].length = (entry->f_type == EXEC_TYPE) ? (inodes + entry->inode)->length : 0;
+        copied++;
+        (*cursor)++;
+    }
+    return copied;
+}
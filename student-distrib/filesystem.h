@@ -9,12 +9,42 @@
 #define METADATA_SIZE 64
 #define NUM_DENTRIES 63
 #define NUM_DATA_BLOCKS 1023
-#define DENTRY_RESERVE 24
+#define DENTRY_RESERVE 20
 #define BOOT_RESERVE 52
+#define DENTRY_HASH_SIZE 2048    /* power of 2, kept at least twice FS_MAX_DENTRIES so probe chains stay short */
+#define DENTRY_HASH_EMPTY 0xFFFF /* marks an unused slot in the dentry index */
+#define MAX_EXTENTS 8          /* files split into more runs than this are read through data_block[] */
+#define FS_MAX_BLOCKS 2048     /* data blocks tracked by the free-block bitmap */
+#define FS_MAX_INODES 256      /* inodes tracked by the free-inode bitmap */
+#define FS_MEM_LIMIT 0x800000  /* data blocks may grow up to here, the end of the kernel's 4 MB page */
+#define BITS_PER_WORD 32
+
+/* Extended (v2) images put FS_V2_MAGIC in the boot block's reserved bytes.
+ * Their inodes use the last two data_block[] entries as single and double
+ * indirect blocks, and the directory continues past the boot block into
+ * up to MAX_DIR_BLOCKS data blocks of DENTRIES_PER_BLOCK entries each. */
+#define FS_V2_MAGIC 0x32534631   /* "1FS2" */
+#define NUM_DIRECT_V2 (NUM_DATA_BLOCKS - 2)
+#define SINGLE_INDIRECT (NUM_DATA_BLOCKS - 2)
+#define DOUBLE_INDIRECT (NUM_DATA_BLOCKS - 1)
+#define PTRS_PER_BLOCK (BLOCK_SIZE / 4)
+#define MAX_DIR_BLOCKS 11
+#define DENTRIES_PER_BLOCK (BLOCK_SIZE / METADATA_SIZE)
+#define FS_MAX_DENTRIES (NUM_DENTRIES + MAX_DIR_BLOCKS * DENTRIES_PER_BLOCK)
+
+/* A regular file whose dentry has DENTRY_LZ4 set stores an LZ4 stream in
+ * its data blocks, while the inode length stays the decompressed size. The
+ * stream starts with a table of uint32_t offsets, one per BLOCK_SIZE chunk
+ * of the file plus one for the end of the stream; chunk i is the LZ4 block
+ * from offset[i] to offset[i + 1], stored as is when that is no shorter
+ * than the chunk. tools/lz4img packs images this way. */
+#define DENTRY_LZ4 0x1
+#define LZ4_CACHE_SLOTS 8   /* decompressed chunks kept around for repeated and sequential reads */
 typedef struct dentry_t {
 	unsigned char f_name[MAX_FILE_NAME_LEN];
 	unsigned int f_type;
 	unsigned int inode;
+	unsigned int flags;      /* DENTRY_LZ4, 0 in images made by createfs */
 	unsigned char reserved[DENTRY_RESERVE]; 
 } dentry_t;
 
@@ -22,10 +52,50 @@ typedef struct bootblock {
 	unsigned int num_entries;
 	unsigned int num_inodes;
 	unsigned int num_blocks;
-	unsigned char reserved[BOOT_RESERVE];
+	union {
+		unsigned char reserved[BOOT_RESERVE];
+		struct {                         /* only meaningful when magic is FS_V2_MAGIC */
+			uint32_t magic;
+			uint32_t dir_blocks;         /* directory blocks after the boot block     */
+			uint32_t dir_block[MAX_DIR_BLOCKS];
+		} ext;
+	};
 	dentry_t entries[NUM_DENTRIES];   
 } bootblock;
 
+/* Open-addressed hash table from file name to index into bootblock->entries */
+typedef struct dentry_index_t {
+	uint16_t slot[DENTRY_HASH_SIZE];
+} dentry_index_t;
+
+/* A run of consecutive data block numbers */
+typedef struct extent_t {
+	uint32_t start;  /* first data block of the run */
+	uint32_t length; /* number of blocks in the run */
+} extent_t;
+
+/* Compact copy of an inode's block list, kept per open file */
+typedef struct extent_map_t {
+	uint32_t count;               /* 0 if the file is empty or too fragmented to cache */
+	uint32_t blocks;              /* blocks covered by the runs, a write past them makes the map stale */
+	extent_t run[MAX_EXTENTS];
+} extent_map_t;
+
+/* One entry returned by getdents */
+typedef struct dirent_t {
+	uint8_t f_name[MAX_FILE_NAME_LEN]; /* not NUL terminated if the name uses all 32 characters */
+	uint32_t f_type;
+	uint32_t length;                   /* file size in bytes, 0 for rtc and directories */
+} dirent_t;
+
+/* One decompressed chunk of a compressed file */
+typedef struct lz4_slot_t {
+	uint32_t inode;          /* FS_MAX_INODES when the slot is empty */
+	uint32_t chunk;
+	uint32_t last_used;      /* lz4_clock at the last hit, the smallest one gets evicted */
+	uint8_t data[BLOCK_SIZE];
+} lz4_slot_t;
+
 typedef struct inode {
 	uint32_t length;
 	uint32_t data_block[NUM_DATA_BLOCKS];
@@ -42,10 +112,26 @@ void init_fs();
 int32_t fs_open(const uint8_t * filename);
 int32_t fs_close(int32_t fd);
 int32_t fs_write(int32_t fd, const void * buf, int32_t nbytes);
+int32_t fs_create(const uint8_t * fname);
+int32_t write_data(uint32_t inode, uint32_t offset, const uint8_t * buf, uint32_t length);
+uint32_t fs_free_blocks();
+void fs_dump_serial();
+uint32_t fs_compressed(uint32_t inode);
+void lz4_cache_flush();
+void lz4_cache_stats(uint32_t * hits, uint32_t * misses);
 int32_t read_dentry_by_name (const uint8_t* fname,dentry_t* dentry);
 int32_t read_dentry_by_index (uint32_t index, dentry_t* dentry);
+void dentry_index_build(dentry_index_t * index, const bootblock * boot);
+int32_t dentry_index_insert(dentry_index_t * index, const bootblock * boot, uint32_t entry);
+int32_t dentry_index_lookup(const dentry_index_t * index, const bootblock * boot, const uint8_t * fname);
 int32_t read_data (uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+uint8_t * file_block(uint32_t inode, uint32_t block);
+uint32_t fs_max_entries(const bootblock * boot);
+int32_t build_extents(uint32_t inode, extent_map_t * map);
+int32_t read_extents(const extent_map_t * map, uint32_t inode, uint32_t offset, uint8_t * buf, uint32_t length);
 int32_t dir_read(int32_t fd, void * buf, int32_t nbytes);
+int32_t dir_lseek(int32_t fd, int32_t offset, int32_t whence);
+int32_t read_dirents(uint32_t * cursor, dirent_t * buf, uint32_t max);
 int32_t fs_read(int32_t fd, void* buf, int32_t nbytes);
 int32_t dir_open(const uint8_t * filename);
 int32_t dir_close(int32_t fd);
@@ -0,0 +1,365 @@
+#include "frame.h"
+#include "malloc.h"
+#include "lib.h"
+#include "page.h"
+
+#define MB_FLAG_MEM  0x1   /* mem_lower/mem_upper are valid */
+#define MB_FLAG_MODS 0x8   /* mods_count/mods_addr are valid */
+#define MB_FLAG_MMAP 0x40  /* mmap_length/mmap_addr are valid */
+#define BITS_PER_WORD 32
+#define WORDS_PER_REGION (FRAMES_PER_REGION / BITS_PER_WORD)
+#define FULL_WORD 0xFFFFFFFF
+
+/* One bit per 4 KB frame, set while the frame is in use or isn't RAM.
+ * region_free counts the clear bits of every 4 MB region, so whole regions
+ * are found without scanning their bits and single frames are taken from
+ * regions that are already broken up before an untouched one is split. */
+static uint32_t frame_bitmap[FRAME_COUNT / BITS_PER_WORD];
+static uint16_t region_free[REGION_COUNT];
+static uint32_t total_frames; /* RAM frames the map reported, reserved ones included */
+
+/* Address spaces cloned by fork share frames until one side writes, so
+ * every frame from alloc_frame counts its mappings and free_frame only
+ * gives it back with the last one. */
+static uint16_t frame_refs[FRAME_COUNT];
+
+/* Frames zeroed ahead of time by processes that are only waiting for an
+ * interrupt, so page faults and new segments don't clear pages themselves.
+ * They count as free: alloc_frame takes them back when nothing else is left. */
+static uint32_t zero_pool[ZERO_POOL_SIZE];
+static uint32_t zero_depth;
+static uint32_t zero_hits;
+static uint32_t zero_misses;
+
+/* set_range()
+ * Description: Marks every frame overlapping [start, end) used or free.
+ * Inputs: start - first physical address
+ *         end - physical address just past the range
+ *         used - 1 to mark the frames used, 0 to mark them free
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Keeps region_free in step with the bitmap
+ */
+static void set_range(uint32_t start, uint32_t end, uint32_t used) {
+    uint32_t frame, bit;
+
+    if (end > FRAME_MAX_MEM || end < start) {
+        end = FRAME_MAX_MEM;
+    }
+    for (frame = start / FRAME_SIZE; frame < (end + FRAME_SIZE - 1) / FRAME_SIZE; frame++) {
+        bit = 1 << (frame % BITS_PER_WORD);
+        if (used && !(frame_bitmap[frame / BITS_PER_WORD] & bit)) {
+            frame_bitmap[frame / BITS_PER_WORD] |= bit;
+            region_free[frame / FRAMES_PER_REGION]--;
+        } else if (!used && (frame_bitmap[frame / BITS_PER_WORD] & bit)) {
+            frame_bitmap[frame / BITS_PER_WORD] &= ~bit;
+            region_free[frame / FRAMES_PER_REGION]++;
+        }
+    }
+}
+
+/* init_frames()
+ * Description: Builds the frame bitmap from the multiboot memory map (or
+ *              from mem_upper when there is no map), then takes out the
+ *              low 8 MB, the boot modules and the kernel heap.
+ * Inputs: mbi - multiboot information from the boot loader
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void init_frames(multiboot_info_t *mbi) {
+    memory_map_t *mmap;
+    module_t *mod;
+    uint32_t i, start, end;
+
+    /* everything starts out used, only RAM the boot loader reports is freed */
+    memset(frame_bitmap, 0xFF, sizeof(frame_bitmap));
+    memset(region_free, 0, sizeof(region_free));
+    if (mbi->flags & MB_FLAG_MMAP) {
+        for (mmap = (memory_map_t *) mbi->mmap_addr;
+             (uint32_t) mmap < mbi->mmap_addr + mbi->mmap_length;
+             mmap = (memory_map_t *) ((uint32_t) mmap + mmap->size + sizeof(mmap->size))) {
+            if (mmap->type != MMAP_AVAILABLE || mmap->base_addr_high != 0 || mmap->base_addr_low >= FRAME_MAX_MEM) {
+                continue;
+            }
+            /* only whole frames inside the range are usable */
+            start = (mmap->base_addr_low + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+            end = mmap->base_addr_low + mmap->length_low;
+            if (mmap->length_high != 0 || end < mmap->base_addr_low || end > FRAME_MAX_MEM) {
+                end = FRAME_MAX_MEM;
+            }
+            end &= ~(FRAME_SIZE - 1);
+            if (end > start) {
+                set_range(start, end, 0);
+            }
+        }
+    } else if (mbi->flags & MB_FLAG_MEM) {
+        /* mem_upper is the KB of RAM starting at 1 MB */
+        set_range(0x100000, 0x100000 + mbi->mem_upper * 1024, 0);
+    }
+    total_frames = 0;
+    for (i = 0; i < REGION_COUNT; i++) {
+        total_frames += region_free[i];
+    }
+
+    set_range(0, FRAME_RESERVED, 1);
+    set_range(KHEAP_START, KHEAP_START + KHEAP_SIZE, 1);
+    if (mbi->flags & MB_FLAG_MODS) {
+        mod = (module_t *) mbi->mods_addr;
+        for (i = 0; i < mbi->mods_count; i++, mod++) {
+            set_range(mod->mod_start, mod->mod_end, 1);
+        }
+    }
+}
+
+/* take_frame()
+ * Description: Takes one free 4 KB frame, preferring regions that already
+ *              have frames in use so whole 4 MB regions stay available.
+ * Inputs: none
+ * Outputs: none
+ * Returns: physical address of the frame, 0 if memory is full
+ * Side Effects: Disables interrupts while the bitmap changes. Takes a frame
+ *               from the zero pool once no other frame is free.
+ */
+static uint32_t take_frame() {
+    uint32_t flags, region, best = REGION_COUNT, word, bit;
+    uint32_t *words;
+
+    cli_and_save(flags);
+    for (region = 0; region < REGION_COUNT; region++) {
+        if (region_free[region] == 0) {
+            continue;
+        }
+        if (region_free[region] < FRAMES_PER_REGION) {
+            best = region;
+            break;
+        }
+        if (best == REGION_COUNT) {
+            best = region;
+        }
+    }
+    if (best == REGION_COUNT) {
+        word = (zero_depth > 0) ? zero_pool[--zero_depth] : 0;
+        restore_flags(flags);
+        return word;
+    }
+
+    words = frame_bitmap + best * WORDS_PER_REGION;
+    for (word = 0; words[word] == FULL_WORD; word++);
+    for (bit = 0; words[word] & (1 << bit); bit++);
+    words[word] |= 1 << bit;
+    region_free[best]--;
+    frame_refs[(best * WORDS_PER_REGION + word) * BITS_PER_WORD + bit] = 1;
+    restore_flags(flags);
+    return ((best * WORDS_PER_REGION + word) * BITS_PER_WORD + bit) * FRAME_SIZE;
+}
+
+/* alloc_frame()
+ * Description: Takes one free 4 KB frame like take_frame. Once RAM is
+ *              full, a user page is written out to swap for its frame.
+ * Inputs: none
+ * Outputs: none
+ * Returns: physical address of the frame, 0 if memory and swap are full
+ * Side Effects: Disables interrupts, may busy wait on the swap disk
+ */
+uint32_t alloc_frame() {
+    uint32_t flags, frame;
+
+    cli_and_save(flags);
+    frame = take_frame();
+    if (frame == 0 && swap_out_page()) {
+        frame = take_frame();
+    }
+    restore_flags(flags);
+    return frame;
+}
+
+/* alloc_zeroed_frame()
+ * Description: Takes a frame that is already zero filled from the zero
+ *              pool, zeroing a fresh one only when the pool is empty.
+ * Inputs: none
+ * Outputs: none
+ * Returns: physical address of the frame, 0 if memory is full
+ * Side Effects: Disables interrupts while the pool changes
+ */
+uint32_t alloc_zeroed_frame() {
+    uint32_t flags, frame;
+
+    cli_and_save(flags);
+    if (zero_depth > 0) {
+        frame = zero_pool[--zero_depth];
+        zero_hits++;
+    } else {
+        zero_misses++;
+        frame = alloc_frame();
+        if (frame != 0) {
+            zero_frame(frame);
+        }
+    }
+    restore_flags(flags);
+    return frame;
+}
+
+/* refill_zero_pool()
+ * Description: Zeroes free frames into the zero pool until it is full.
+ *              Every frame is done with interrupts off, so this can be
+ *              called with them on and stopped between any two frames.
+ * Inputs: max - most frames to zero in this call
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Stops early if no frame is free
+ */
+void refill_zero_pool(uint32_t max) {
+    uint32_t flags, frame;
+
+    while (max-- > 0) {
+        cli_and_save(flags);
+        /* never swap anything out just to fill the pool */
+        if (zero_depth >= ZERO_POOL_SIZE || (frame = take_frame()) == 0) {
+            restore_flags(flags);
+            return;
+        }
+        zero_frame(frame);
+        zero_pool[zero_depth++] = frame;
+        restore_flags(flags);
+    }
+}
+
+/* zero_pool_stats()
+ * Description: Reports how full the zero pool is and how often it had a
+ *              frame ready.
+ * Inputs: depth - filled with the number of frames in the pool
+ *         hits - filled with alloc_zeroed_frame calls the pool served
+ *         misses - filled with the ones that had to zero a frame themselves
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void zero_pool_stats(uint32_t *depth, uint32_t *hits, uint32_t *misses) {
+    *depth = zero_depth;
+    *hits = zero_hits;
+    *misses = zero_misses;
+}
+
+/* free_frame()
+ * Description: Drops one mapping of a frame from alloc_frame, giving the
+ *              frame back when it was the last one.
+ * Inputs: paddr - physical address of the frame
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Addresses below FRAME_RESERVED (the filesystem image) are ignored
+ */
+void free_frame(uint32_t paddr) {
+    uint32_t flags, frame = paddr / FRAME_SIZE;
+
+    if (paddr < FRAME_RESERVED || paddr >= FRAME_MAX_MEM) {
+        return;
+    }
+    cli_and_save(flags);
+    if (frame_refs[frame] > 1) {
+        frame_refs[frame]--;
+    } else {
+        frame_refs[frame] = 0;
+        set_range(paddr, paddr + FRAME_SIZE, 0);
+    }
+    restore_flags(flags);
+}
+
+/* share_frame()
+ * Description: Counts one more mapping of a frame from alloc_frame.
+ * Inputs: paddr - physical address of the frame
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Addresses below FRAME_RESERVED (the filesystem image) are ignored
+ */
+void share_frame(uint32_t paddr) {
+    uint32_t flags;
+
+    if (paddr < FRAME_RESERVED || paddr >= FRAME_MAX_MEM) {
+        return;
+    }
+    cli_and_save(flags);
+    frame_refs[paddr / FRAME_SIZE]++;
+    restore_flags(flags);
+}
+
+/* frame_shared()
+ * Description: Tells whether more than one page maps a frame.
+ * Inputs: paddr - physical address of the frame
+ * Outputs: none
+ * Returns: 1 if the frame is shared or isn't from alloc_frame, 0 if one page owns it
+ * Side Effects: none
+ */
+uint32_t frame_shared(uint32_t paddr) {
+    if (paddr < FRAME_RESERVED || paddr >= FRAME_MAX_MEM) {
+        return 1;
+    }
+    return frame_refs[paddr / FRAME_SIZE] != 1;
+}
+
+/* alloc_region()
+ * Description: Takes a whole free 4 MB region, aligned so it can back a
+ *              4 MB page or a full page table.
+ * Inputs: none
+ * Outputs: none
+ * Returns: physical address of the region, 0 if no region is completely free
+ * Side Effects: Disables interrupts while the bitmap changes
+ */
+uint32_t alloc_region() {
+    uint32_t flags, region;
+
+    cli_and_save(flags);
+    for (region = 0; region < REGION_COUNT; region++) {
+        if (region_free[region] == FRAMES_PER_REGION) {
+            memset(frame_bitmap + region * WORDS_PER_REGION, 0xFF, WORDS_PER_REGION * sizeof(uint32_t));
+            region_free[region] = 0;
+            restore_flags(flags);
+            return region * REGION_SIZE;
+        }
+    }
+    restore_flags(flags);
+    return 0;
+}
+
+/* free_region()
+ * Description: Gives back a region from alloc_region.
+ * Inputs: paddr - physical address of the region
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void free_region(uint32_t paddr) {
+    uint32_t flags;
+
+    if (paddr < FRAME_RESERVED || paddr >= FRAME_MAX_MEM || (paddr & (REGION_SIZE - 1))) {
+        return;
+    }
+    cli_and_save(flags);
+    set_range(paddr, paddr + REGION_SIZE, 0);
+    restore_flags(flags);
+}
+
+/* frame_stats()
+ * Description: Reports how much physical memory there is and how much is free.
+ * Inputs: total - filled with the number of RAM frames
+ *         free - filled with the number of free frames, the zero pool's included
+ *         free_regions - filled with the number of completely free 4 MB regions
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void frame_stats(uint32_t *total, uint32_t *free, uint32_t *free_regions) {
+    uint32_t flags, region;
+
+    cli_and_save(flags);
+    *total = total_frames;
+    *free = zero_depth;
+    *free_regions = 0;
+    for (region = 0; region < REGION_COUNT; region++) {
+        *free += region_free[region];
+        if (region_free[region] == FRAMES_PER_REGION) {
+            (*free_regions)++;
+        }
+    }
+    restore_flags(flags);
+}
@@ -0,0 +1,29 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "types.h"
+#include "multiboot.h"
+
+#define FRAME_SIZE       4096
+#define REGION_SIZE      0x400000                         /* 4 MB, one large page                  */
+#define FRAMES_PER_REGION (REGION_SIZE / FRAME_SIZE)
+#define FRAME_MAX_MEM    0x40000000                       /* RAM above 1 GB is ignored             */
+#define FRAME_COUNT      (FRAME_MAX_MEM / FRAME_SIZE)
+#define REGION_COUNT     (FRAME_MAX_MEM / REGION_SIZE)
+#define FRAME_RESERVED   0x800000                         /* kernel and filesystem image              */
+#define MMAP_AVAILABLE   1                                /* multiboot memory map type of usable RAM */
+#define ZERO_POOL_SIZE   128                              /* frames kept zeroed ahead of time, 512 KB */
+
+void init_frames(multiboot_info_t *mbi);
+uint32_t alloc_frame();
+uint32_t alloc_zeroed_frame();
+void refill_zero_pool(uint32_t max);
+void zero_pool_stats(uint32_t *depth, uint32_t *hits, uint32_t *misses);
+void free_frame(uint32_t paddr);
+void share_frame(uint32_t paddr);
+uint32_t frame_shared(uint32_t paddr);
+uint32_t alloc_region();
+void free_region(uint32_t paddr);
+void frame_stats(uint32_t *total, uint32_t *free, uint32_t *free_regions);
+
+#endif
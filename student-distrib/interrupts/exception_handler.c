@@ -1,6 +1,7 @@
 #include "exception_handler.h"
 #include "../lib.h"
 #include "syscalls.h"
+#include "../page.h"
 
 /* exception_XX()
  * Description: Prints the name of the exception and BSODs.
@@ -107,8 +108,22 @@ void exception_GP() {
    // while(1); 
 }
 
-void exception_PF() {
+/* exception_PF()
+ * Description: Faults in user pages on first use and resolves copy-on-write
+ *              faults, otherwise prints the name of the exception and BSODs
+ *              like the others. A process that runs out of frames is halted.
+ * Inputs: error - error code pushed by the processor
+ * Outputs: none
+ * Returns: none, and only if the fault was resolved
+ * Side Effects: May change the current process's page table
+ */
+void exception_PF(uint32_t error) {
+    uint32_t vaddr;
     cli();
+    asm volatile("movl %%cr2, %0" : "=r"(vaddr));
+    if(handle_page_fault(vaddr, error) == 0) {
+        return;
+    }
     printf("Page Fault!\n");
     exec_halt(EXCEPTION_RET);
     // while(1);
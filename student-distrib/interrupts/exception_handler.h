@@ -1,6 +1,8 @@
 #ifndef EXCEPTION_HANDLER_H
 #define EXCEPTION_HANDLER_H
 
+#include "../types.h"
+
 #define EXCEPTION_RET 256
 
 /* exception handlers */
@@ -18,7 +20,7 @@ extern void exception_TS();
 extern void exception_NP();
 extern void exception_SS();
 extern void exception_GP();
-extern void exception_PF();
+extern void exception_PF(uint32_t error);
 extern void exception_MF();
 extern void exception_AC();
 extern void exception_MC();
@@ -35,6 +35,11 @@ void init_idt() {
         idt[i].present = 1;
     }
 
+    /* page faults use an interrupt gate: CR2 holds the faulting address only
+     * until the next fault, and a process switch before exception_PF reads it
+     * could fault in another process */
+    idt[14].reserved3 = 0;
+
     /* initializing interrupts */
     for(i = 32; i < 256; i++) 
     {
@@ -69,7 +74,7 @@ void init_idt() {
     SET_IDT_ENTRY(idt[11], exception_NP);
     SET_IDT_ENTRY(idt[12], exception_SS);
     SET_IDT_ENTRY(idt[13], exception_GP);
-    SET_IDT_ENTRY(idt[14], exception_PF);
+    SET_IDT_ENTRY(idt[14], page_fault);   /* goes through a linkage so it can return */
     SET_IDT_ENTRY(idt[16], exception_MF);
     SET_IDT_ENTRY(idt[17], exception_AC);
     SET_IDT_ENTRY(idt[18], exception_MC);
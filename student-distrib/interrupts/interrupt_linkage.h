@@ -5,5 +5,6 @@ extern void keyboard();
 extern void RTC();
 extern void PIT();
 extern void mouse();
+extern void page_fault();
 
 #endif
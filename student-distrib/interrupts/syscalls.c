@@ -7,18 +7,50 @@
 #include "../devices/keyboard.h"
 #include "../devices/rtc.h"
 #include "../schedule.h"
+#include "../debug.h"
+#include "../slab.h"
+#include "../frame.h"
+#include "../malloc.h"
+#include "../shm.h"
+#include "../mmap.h"
+#include "../memstat.h"
 
 typedef uint32_t function();
 
 /* Jump tables for file operations based on file type */
-uint32_t stdin_jmp[NUM_OPS] = {NULL, (uint32_t) terminal_read, (uint32_t)terminal_open, (uint32_t)terminal_close};
-uint32_t stdout_jmp[NUM_OPS] = {(uint32_t) terminal_write, NULL, (uint32_t)terminal_open, (uint32_t)terminal_close};
-uint32_t file_jmp[NUM_OPS] = {(uint32_t) fs_write, (uint32_t) fs_read, (uint32_t)fs_open, (uint32_t)fs_close};
-uint32_t dir_jmp[NUM_OPS] = {(uint32_t) dir_write, (uint32_t) dir_read, (uint32_t)dir_open, (uint32_t)dir_close};
-uint32_t rtc_jmp[NUM_OPS] ={(uint32_t) rtc_write, (uint32_t) rtc_read, (uint32_t)rtc_open, (uint32_t)rtc_close};
-
-uint32_t * table_list[NUM_JMP_TABLES] = {rtc_jmp, dir_jmp, file_jmp}; /* Array of required jump tables */
-int8_t pid_list[MAX_PROCESSES] = {NOT_IN_USE, NOT_IN_USE, NOT_IN_USE, NOT_IN_USE, NOT_IN_USE, NOT_IN_USE}; /* List of process usage */
+uint32_t stdin_jmp[NUM_OPS] = {NULL, (uint32_t) terminal_read, (uint32_t)terminal_open, (uint32_t)terminal_close, NULL};
+uint32_t stdout_jmp[NUM_OPS] = {(uint32_t) terminal_write, NULL, (uint32_t)terminal_open, (uint32_t)terminal_close, NULL};
+uint32_t file_jmp[NUM_OPS] = {(uint32_t) fs_write, (uint32_t) fs_read, (uint32_t)fs_open, (uint32_t)fs_close, (uint32_t)fs_lseek};
+uint32_t dir_jmp[NUM_OPS] = {(uint32_t) dir_write, (uint32_t) dir_read, (uint32_t)dir_open, (uint32_t)dir_close, (uint32_t)dir_lseek};
+uint32_t rtc_jmp[NUM_OPS] ={(uint32_t) rtc_write, (uint32_t) rtc_read, (uint32_t)rtc_open, (uint32_t)rtc_close, NULL};
+uint32_t memstat_jmp[NUM_OPS] = {(uint32_t) memstat_write, (uint32_t) memstat_read, (uint32_t)memstat_open, (uint32_t)memstat_close, (uint32_t)memstat_lseek};
+
+uint32_t * table_list[NUM_JMP_TABLES] = {rtc_jmp, dir_jmp, file_jmp, memstat_jmp}; /* Array of required jump tables */
+static uint32_t pid_map[MAX_PROCESSES / PID_BITS]; /* one bit per pid, set while the pid is taken */
+
+/* stdin and stdout keep no state, so every PCB shares these two descriptors */
+static file_desc_t stdin_desc = {stdin_jmp};
+static file_desc_t stdout_desc = {stdout_jmp};
+
+static kmem_cache_t pcb_cache;     /* PCBs, one per running process          */
+static kmem_cache_t process_cache; /* scheduler entries, one per running process */
+static kmem_cache_t fd_cache;      /* open file descriptors other than stdin/out */
+
+static void discard_pcb(PCB * pcb);
+static void discard_process(process_t * process, PCB * pcb);
+static void release_files(PCB * pcb);
+static void exit_forked(process_t * child_process);
+
+/* kernel_stack()
+ * Description: Gives the kmalloc'd kernel stack a process's esp0 points into.
+ * Inputs: process - process whose stack is wanted
+ * Outputs: none
+ * Returns: start of the stack, KSTACK_SIZE aligned
+ * Side Effects: none
+ */
+static inline void * kernel_stack(process_t * process) {
+    return (void *) (process->esp0 & ~(KSTACK_SIZE - 1));
+}
 
 /* fs_read()
  * Description: Reads data from file fd of current process.
@@ -30,18 +62,18 @@ int8_t pid_list[MAX_PROCESSES] = {NOT_IN_USE, NOT_IN_USE, NOT_IN_USE, NOT_IN_USE
  * Side Effects: updates current position in file
  */
 int32_t fs_read(int32_t fd, void* buf, int32_t nbytes){
-    PCB * get_pcb = (PCB *) (_8MB - (_8KB*(pid + 1))); /* Get current PCB */
-    
+    file_desc_t * file = get_file(fd);
+
     /* Ensure location fd is open */
-    if(get_pcb->file_ops[fd].flags == NOT_IN_USE){
+    if(file == NULL){
         return 0; 
     }
 
-    /* Read data from file */
-    int read = read_data(get_pcb->file_ops[fd].inode, get_pcb->file_ops[fd].file_pos, (uint8_t *) buf, nbytes);
+    /* Read data from file, a run of consecutive blocks at a time */
+    int read = read_extents(&(file->extents), file->inode, file->file_pos, (uint8_t *) buf, nbytes);
     if(read != -1) {
         /* Increment file location */
-        get_pcb->file_ops[fd].file_pos += read; 
+        file->file_pos += read; 
     }
     else {
         /* Return 0 if no bytes were read */
@@ -51,6 +83,55 @@ int32_t fs_read(int32_t fd, void* buf, int32_t nbytes){
     return read; 
 }
 
+/* fs_lseek()
+ * Description: Moves the read position of file fd of current process.
+ * Inputs: fd - index into file array of current process
+ *         offset - new position, relative to whence
+ *         whence - SEEK_SET, SEEK_CUR or SEEK_END
+ * Outputs: none
+ * Returns: new position, -1 if it would fall outside the file
+ * Side Effects: updates current position in file
+ */
+int32_t fs_lseek(int32_t fd, int32_t offset, int32_t whence) {
+    file_desc_t * file = get_file(fd);
+    if(file == NULL) {
+        return -1;
+    }
+    return seek_to(file, offset, whence, (inodes + file->inode)->length);
+}
+
+/* seek_to()
+ * Description: Shared lseek arithmetic for every seekable file type.
+ * Inputs: file - descriptor to move
+ *         offset - new position, relative to whence
+ *         whence - SEEK_SET, SEEK_CUR or SEEK_END
+ *         end - size of the file in the file type's units (bytes, entries)
+ * Outputs: none
+ * Returns: new position, -1 if whence is invalid or the position falls outside [0, end]
+ * Side Effects: updates file->file_pos on success
+ */
+int32_t seek_to(file_desc_t * file, int32_t offset, int32_t whence, uint32_t end) {
+    int32_t base;
+    switch(whence) {
+        case SEEK_SET:
+            base = 0;
+            break;
+        case SEEK_CUR:
+            base = file->file_pos;
+            break;
+        case SEEK_END:
+            base = end;
+            break;
+        default:
+            return -1;
+    }
+    if(base + offset < 0 || base + offset > (int32_t) end) {
+        return -1;
+    }
+    file->file_pos = base + offset;
+    return file->file_pos;
+}
+
 /* halt()
  * Description: Ends current process and returns to parent
  *              process. Clears PCB and kernel stack.
@@ -66,10 +147,12 @@ int32_t halt(uint8_t status){
     cli();
 
     /* mark process as unused in array */
-    pid_list[(uint8_t)pid] = NOT_IN_USE; 
+    put_pid(pid);
 
     /* Get the current process that we're halting */
     PCB *child = current_process->pcb; 
+    process_t *child_process = current_process;
+    uint32_t parent_esp, parent_ebp;
 
     /* Mark open files as closed, clear the PCB's command line, decrement total_processes */
     int j = 0;
@@ -79,23 +162,43 @@ int32_t halt(uint8_t status){
     }
     clear_buffer(child->cmd_line, MAX_BUFF_LEN);
     total_processes--;
+
+    /* Nothing waits for a forked process, the scheduler just moves on */
+    if(child_process->parent == NULL) {
+        exit_forked(child_process);
+    }
     
     /* Make sure shell is always running */
     if(current_process->parent == current_process) {
         total_base--;
+        /* the new shell gets a fresh PCB and memory but keeps this process_t, which is its place in the scheduler,
+         * and its kernel stack, which execute is running on */
+        load_page_dir(Page_Directory);
+        free_user_space(child->pid);
+        kmem_cache_free(&pcb_cache, child);
         execute((uint8_t*)"shell");
     }
 
-    /* Remap 128MB to parent's physical address and update the global PID */
+    /* Switch to the parent's address space and update the global PID */
     pid = child->parent->pid;
-    vmap(_128MB, child->parent->pid); 
+    load_page_dir(user_page_dir(child->parent->pid)); 
 
     /* Call relevant scheduling functions to update processes array and linked list */
-    start_process(&(processes[child->parent->pid]));
-    remove_process(&(processes[child->pid]));
+    start_process(processes[child->parent->pid]);
+    remove_process(child_process);
+
+    /* Give the child's memory, PCB and process back, keeping what the switch needs */
+    parent_esp = child->parent_esp;
+    parent_ebp = child->parent_ebp;
+    free_user_space(child->pid);
+    processes[child->pid] = NULL;
+    kmem_cache_free(&pcb_cache, child);
+    /* still running on this stack, but freeing it only writes list links at its bottom and nothing allocates before the switch */
+    kfree(kernel_stack(child_process));
+    kmem_cache_free(&process_cache, child_process);
 
     /* Switch context and restore parent's ESP/EBP*/
-    tss.esp0 = child->parent_esp;          
+    tss.esp0 = parent_esp;          
     asm volatile(   "xorl %%eax, %%eax;"
                     "movb %0, %%al;"
                     "movl %1, %%esp;"
@@ -104,7 +207,7 @@ int32_t halt(uint8_t status){
                     "leave;"
                     "ret;"
                     :
-                    : "r"(status), "r"(child->parent_esp), "r"(child->parent_ebp)
+                    : "r"(status), "r"(parent_esp), "r"(parent_ebp)
                     : "%eax"
     );
 
@@ -123,19 +226,40 @@ int32_t halt(uint8_t status){
  * Side Effects: Returns to parent process
  */
 int32_t exec_halt(uint32_t status){
-    pid_list[(uint8_t) pid] = NOT_IN_USE;
-    PCB * child = ((PCB *) (_8MB - _8KB*(pid + 1)));
-    pid = ((PCB *) (_8MB - _8KB*(pid + 1)))->parent->pid; 
+    put_pid(pid);
+    PCB * child = current_process->pcb;
+    process_t * child_process = current_process;
     int j = 0;
+    if(child_process->parent == NULL) {
+        while (j < MAX_FILES) {
+            close(j);
+            j++;
+        }
+        total_processes--;
+        exit_forked(child_process);
+    }
+    uint32_t parent_esp = child->parent_esp;
+    uint32_t parent_ebp = child->parent_ebp;
+    pid = child->parent->pid; 
     while (j < MAX_FILES) {
         close(j);
         j++;
     }
-    vmap(_128MB, child->parent->pid);
-    tss.esp0 = child->parent_esp;
+    load_page_dir(user_page_dir(child->parent->pid));
+    tss.esp0 = parent_esp;
     total_processes--;
-    remove_process(&(processes[child->pid]));
-    start_process(&(processes[child->parent->pid]));
+    remove_process(child_process);
+    start_process(processes[child->parent->pid]);
+
+    /* base shells return into themselves, so only a child's objects can go */
+    if(child->parent != child) {
+        free_user_space(child->pid);
+        processes[child->pid] = NULL;
+        kmem_cache_free(&pcb_cache, child);
+        /* still running on this stack, see halt */
+        kfree(kernel_stack(child_process));
+        kmem_cache_free(&process_cache, child_process);
+    }
 
     asm volatile(   "xorl %%eax, %%eax;"
                     "movl %0, %%eax;"
@@ -144,7 +268,7 @@ int32_t exec_halt(uint32_t status){
                     "leave;"
                     "ret;"
                     :
-                    : "r"(status), "r"(child->parent_esp), "r"(child->parent_ebp)
+                    : "r"(status), "r"(parent_esp), "r"(parent_ebp)
                     : "%eax"
     );
     return 0;
@@ -156,15 +280,10 @@ int32_t exec_halt(uint32_t status){
  *              and allocates memory for child process.
  * Inputs: command - name of the executable
  * Outputs: none
- * Returns: -1 on failure, -2 when excess processes, 0-255 on success, and 256 if an exception was generated.
+ * Returns: -1 on failure, -2 when no pid or memory is left for another process, 0-255 on success, and 256 if an exception was generated.
  * Side Effects: none
  */
 int32_t execute(const uint8_t * command) {
-    /* Don't execute a command if it causes process overflow */
-    if(total_processes >= MAX_PROCESSES) {
-        return -2;
-    }
-
     /* Don't want interrupts to occur during execute logic */
     cli(); 
 
@@ -173,7 +292,6 @@ int32_t execute(const uint8_t * command) {
     dentry_t dentry_temp;              /* Dentry to fill with executable                 */
     dentry_t * dentry = &dentry_temp;  /* Pointer to dentry                              */
     uint8_t * dest;                    /* Pointer to physical address for instructions   */
-    int vret;                          /* Return value of vmap                           */
     int32_t data_ret;                  /* Return value of read_data                      */
     int32_t not_same;                  /* Return value of strncmp                        */
     int n;                             /* Return value of read_data                      */
@@ -181,6 +299,8 @@ int32_t execute(const uint8_t * command) {
     int j;                             /* General use integer                            */
     int32_t ret;                       /* Return for read_dentry_by_name                 */
     PCB *pcb;                          /* Pointer to new PCB                             */
+    process_t *process;                /* Scheduler entry for the new process            */
+    uint8_t *stack;                    /* Kernel stack for a new scheduler entry         */
 
     /* Copy actual command from buffer into copy_cmd */
     uint8_t i = 0;
@@ -242,8 +362,23 @@ int32_t execute(const uint8_t * command) {
     /* Generate PCB for new process */
     pcb = createPCB();
     if(pcb == NULL) {
-        pid_list[(uint8_t) pid] = NOT_IN_USE;
-        return -1;
+        sti();
+        return -2;
+    }
+
+    /* A base shell restarting from halt is still in the scheduler ring, so it reuses its process_t and kernel stack */
+    process = processes[pid];
+    if(process == NULL) {
+        process = kmem_cache_alloc(&process_cache);
+        stack = (process == NULL) ? NULL : kmalloc(KSTACK_SIZE);
+        if(stack == NULL) {
+            kmem_cache_free(&process_cache, process);
+            discard_pcb(pcb);
+            sti();
+            return -2;
+        }
+        /* subtract 4 bytes to get pointer into valid kernel stack range, keeping it aligned */
+        process->esp0 = (uint32_t) stack + KSTACK_SIZE - 4;
     }
 
     /* Copy arguments into pcb */
@@ -252,18 +387,20 @@ int32_t execute(const uint8_t * command) {
         pcb->cmd_line[x] = arguments[x];
     }
 
-    /* Map the process to virual memory */
-    vret = vmap(_128MB, pid); 
-    if(vret != 0) {
+    /* Give the process an empty address space, its pages fault in as they are used */
+    if(init_user_space(pid) == -1) {
+        discard_process(process, pcb);
         sti();
-        return -1;
+        return -2;
     }
+    load_page_dir(user_page_dir(pid));
 
-    /* Read the executable instructions to memory */
+    /* Back the program's pages with the executable */
     dest = (uint8_t*) (_128MB + EXEC_OFFSET);
-    n = read_data(dentry->inode, 0, (uint8_t*) dest, (inodes + dentry->inode)->length); 
+    n = load_program(dentry->inode, pid);
     /* validate successful read */
     if(n == -1 || n == 0) {
+        discard_process(process, pcb);
         sti();
         return -1;
     }
@@ -277,39 +414,35 @@ int32_t execute(const uint8_t * command) {
         v_first += dest[INSTR_START + j];
     }
 
-    /* Create and add process */
-    process_t process;
-    process.terminal = &(terminals[curr_tid]);
-    process.pid = pid;
-    process.pcb = pcb; 
-    /* subtract 4 bytes to get pointer into valid kernel stack range (can't be 8 MB, 12MB, so subtract 4 instead of 1 to keep it aligned) */
-    process.esp0 = _8MB - (_8KB * (pcb->pid)) - 4;
+    /* Fill in and add process */
+    process->terminal = &(terminals[curr_tid]);
+    process->pid = pid;
+    process->pcb = pcb; 
 
     /* The first 3 shells (base shells) are parents to themselves, otherwise the parent is the current process that executed a command */
     if(total_base < MAX_TERMINALS) {
-        process.parent = &processes[pid];
-        process.next = processes[pid].next;
+        process->parent = process;
         total_base++;
     }
     else {
-        process.parent = &processes[current_process->pid];
+        process->parent = current_process;
     }
 
-    /* init the ebp esp and next to point to itself in the start */
+    /* the first process takes over the boot process's stack and starts the ring on its own */
     if(total_processes == START) {
-        process.esp = processes[START].esp;
-        process.ebp = processes[START].ebp;
-        process.next = &processes[START];
+        process->esp = current_process->esp;
+        process->ebp = current_process->ebp;
+        process->next = process;
+        current_process = process;
     }
 
     /* add process to scheduler and start it */
-    add_process(&process);
-    start_process(&process);
+    add_process(process);
+    start_process(process);
 
     /* Context switch */
     tss.ss0 = KERNEL_DS;
-    /* subtract 4 bytes to get pointer into valid kernel stack range (can't be 8 MB, 12MB, so subtract 4 instead of 1 to keep it aligned) */
-    tss.esp0 = _8MB - (_8KB * (pcb->pid)) - 4;
+    tss.esp0 = process->esp0;
 
     /* Get current esp / ebp and store into pcb */
     asm volatile("movl %%esp, %0":"=g"(pcb->parent_esp));
@@ -340,6 +473,250 @@ int32_t execute(const uint8_t * command) {
     return 0; /* Shouldn't ever reach here */
 }
 
+/* image_end()
+ * Description: Finds where a program's memory ends, bss included, from
+ *              the loadable segments in its ELF program headers.
+ * Inputs: inode_idx - inode of the executable
+ * Outputs: none
+ * Returns: user address just past the last loadable segment, 0 if the
+ *          program headers can't be read
+ * Side Effects: none
+ */
+static uint32_t image_end(uint32_t inode_idx) {
+    elf_header_t header;
+    elf_phdr_t phdr;
+    uint32_t i, end = 0;
+
+    if(read_data(inode_idx, 0, (uint8_t *) &header, sizeof(header)) != sizeof(header) ||
+       header.phentsize < sizeof(phdr) || header.phnum > ELF_MAX_PHDRS) {
+        return 0;
+    }
+    for(i = 0; i < header.phnum; i++) {
+        if(read_data(inode_idx, header.phoff + i * header.phentsize, (uint8_t *) &phdr, sizeof(phdr)) != sizeof(phdr)) {
+            return 0;
+        }
+        if(phdr.type == PT_LOAD && phdr.vaddr + phdr.memsz > end) {
+            end = phdr.vaddr + phdr.memsz;
+        }
+    }
+    return end;
+}
+
+/* load_program()
+ * Description: Sets up an executable to back a process's pages from
+ *              0x8048000 on, and starts the process's heap after the
+ *              program's bss. Nothing is read here: each page is mapped out
+ *              of the filesystem image or read in by handle_page_fault the
+ *              first time the process (or execute, reading the entry
+ *              point) touches it.
+ * Inputs: inode_idx - inode of the executable
+ *         pid_ - process being loaded
+ * Outputs: none
+ * Returns: length of the executable, -1 if it doesn't fit in the user region
+ * Side Effects: none
+ */
+int32_t load_program(uint32_t inode_idx, uint32_t pid_) {
+    uint32_t length = (inodes + inode_idx)->length;
+    uint32_t end = image_end(inode_idx);
+
+    if(length > _4MB - EXEC_OFFSET) {
+        return -1;
+    }
+    /* program headers that don't fit the user region are ignored, the heap then starts after the file */
+    if(end < _128MB || end > _128MB + _4MB - USER_STACK_SIZE) {
+        end = 0;
+    }
+    set_user_image(pid_, inode_idx, length, end);
+    return length;
+}
+
+/* sbrk()
+ * Description: Grows or shrinks the current process's heap, which starts
+ *              on the page after the program and its bss.
+ * Inputs: increment - bytes to add to the heap, negative to give them back
+ * Outputs: none
+ * Returns: the old end of the heap, which is the start of the new memory
+ *          when growing, -1 on failure
+ * Side Effects: New heap pages fault in zero filled
+ */
+int32_t sbrk(int32_t increment) {
+    int32_t old;
+
+    cli();
+    old = user_sbrk(pid, increment);
+    sti();
+    return old;
+}
+
+/* shm_create()
+ * Description: Finds the shared memory segment with a key, creating it
+ *              zero filled if no process has made it yet.
+ * Inputs: key - name every process using the segment agrees on
+ *         size - bytes needed, at most SHM_MAX_PAGES pages
+ * Outputs: none
+ * Returns: id of the segment for shm_attach, -1 on failure
+ * Side Effects: none
+ */
+int32_t shm_create(uint32_t key, uint32_t size) {
+    int32_t id;
+
+    cli();
+    id = shm_get(key, size);
+    sti();
+    return id;
+}
+
+/* shm_attach()
+ * Description: Maps a shared memory segment into the current process.
+ * Inputs: id - segment from shm_create
+ * Outputs: none
+ * Returns: user address the segment starts at, -1 on failure
+ * Side Effects: Stores go straight to the frames every attached process maps
+ */
+int32_t shm_attach(int32_t id) {
+    int32_t addr;
+
+    cli();
+    addr = shm_map(pid, id);
+    sti();
+    return addr;
+}
+
+/* shm_detach()
+ * Description: Unmaps a shared memory segment from the current process.
+ * Inputs: addr - address shm_attach returned
+ * Outputs: none
+ * Returns: 0 on success, -1 if no segment is attached there
+ * Side Effects: The segment's frames are freed with the last process to detach
+ */
+int32_t shm_detach(uint32_t addr) {
+    int32_t ret;
+
+    cli();
+    ret = shm_unmap(pid, addr);
+    sti();
+    return ret;
+}
+
+/* fork()
+ * Description: Creates a child process running the same program as the
+ *              current one. The child gets a copy-on-write copy of the
+ *              address space and its own copy of every open descriptor,
+ *              and is scheduled next to its parent instead of replacing it.
+ * Inputs: none
+ * Outputs: none
+ * Returns: the child's pid to the parent and 0 to the child, -1 on failure
+ * Side Effects: The child starts at the parent's return from fork
+ */
+int32_t fork(void) {
+    process_t * parent = current_process;
+    process_t * process;
+    file_desc_t * file;
+    uint8_t * stack;
+    PCB * pcb;
+    int32_t fd;
+
+    cli();
+    pcb = createPCB();
+    if(pcb == NULL) {
+        sti();
+        return -1;
+    }
+    process = kmem_cache_alloc(&process_cache);
+    stack = (process == NULL) ? NULL : kmalloc(KSTACK_SIZE);
+    if(stack == NULL) {
+        kmem_cache_free(&process_cache, process);
+        discard_pcb(pcb);
+        sti();
+        return -1;
+    }
+    /* subtract 4 bytes to get pointer into valid kernel stack range, keeping it aligned */
+    process->esp0 = (uint32_t) stack + KSTACK_SIZE - 4;
+
+    /* stdin and stdout are shared anyway, every other descriptor is copied with its position */
+    pcb->parent = parent->pcb;
+    for(fd = STD_OUT + 1; fd < MAX_FILES; fd++) {
+        if(parent->pcb->file_ops[fd] == NULL) {
+            continue;
+        }
+        file = kmem_cache_alloc(&fd_cache);
+        if(file == NULL) {
+            break;
+        }
+        memcpy(file, parent->pcb->file_ops[fd], sizeof(file_desc_t));
+        pcb->file_ops[fd] = file;
+    }
+    if(fd < MAX_FILES || clone_user_space(parent->pid, pcb->pid) == -1) {
+        release_files(pcb);
+        discard_process(process, pcb);
+        sti();
+        return -1;
+    }
+    memcpy(pcb->cmd_line, parent->pcb->cmd_line, MAX_BUFF_LEN);
+
+    /* The parent's interrupt frame, the registers sys_call saved and the user's EBP it
+     * pushed as the sixth argument sit at the top of its kernel stack. The child gets a
+     * copy for fork_return to pop when context_switch first runs it. */
+    memcpy((uint8_t *) process->esp0 - FORK_FRAME, (uint8_t *) parent->esp0 - FORK_FRAME, FORK_FRAME);
+    process->esp = process->esp0 - FORK_FRAME;
+    process->ebp = 0;
+
+    process->terminal = parent->terminal;
+    process->pid = pcb->pid;
+    process->pcb = pcb;
+    process->parent = NULL;
+    insert_process(process);
+    total_processes++;
+
+    /* createPCB switched the global pid to the child */
+    pid = parent->pid;
+    sti();
+    return process->pid;
+}
+
+/* release_files()
+ * Description: Frees the descriptors fork copied into a PCB that never ran.
+ * Inputs: pcb - the child's PCB
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+static void release_files(PCB * pcb) {
+    int32_t fd;
+    for(fd = STD_OUT + 1; fd < MAX_FILES; fd++) {
+        kmem_cache_free(&fd_cache, pcb->file_ops[fd]);
+        pcb->file_ops[fd] = NULL;
+    }
+}
+
+/* exit_forked()
+ * Description: Ends a forked process. Nothing waits for it, so instead of
+ *              returning to a parent it frees its memory, PCB, kernel
+ *              stack and process_t and lets the next process in the
+ *              scheduler ring run.
+ * Inputs: child_process - the forked process, the current one, with its
+ *                         files already closed
+ * Outputs: none
+ * Returns: never
+ * Side Effects: Switches to the next process's stack and address space
+ */
+static void exit_forked(process_t * child_process) {
+    static process_t exited; /* takes the context context_switch saves, nobody switches back to it */
+    PCB * child = child_process->pcb;
+    process_t * next = drop_process(child_process);
+
+    load_page_dir(user_page_dir(next->pid));
+    free_user_space(child->pid);
+    processes[child->pid] = NULL;
+    kmem_cache_free(&pcb_cache, child);
+    /* still running on this stack, see halt */
+    kfree(kernel_stack(child_process));
+    kmem_cache_free(&process_cache, child_process);
+
+    current_process = &exited;
+    context_switch(next);
+}
+
 /* read()
  * Description: System call read which calls a helper read function
  *              based on the file type which read data from a file to
@@ -357,19 +734,16 @@ int32_t read (int32_t fd, void* buf, int32_t nbytes){
         return -1;
     }
 
-    /* get the current pcb */
-    PCB * get_pcb = (PCB *) (_8MB - _8KB*(pid + 1));
+    /* get the current process's descriptor */
+    file_desc_t * file = get_file(fd);
 
     /* make sure pcb entry for fd is valid */
-    if(get_pcb->file_ops[fd].flags == NOT_IN_USE) {
-        return -1;
-    }
-     if(get_pcb->file_ops[fd].func_ptr[READ] == NULL) {
+    if(file == NULL || file->func_ptr[READ] == NULL) {
         return -1;
     }
 
     /* Call and return helper function based on file */
-    return  ((function *)  (get_pcb->file_ops[fd].func_ptr[READ])) (fd, (char *) buf, nbytes);
+    return  ((function *)  (file->func_ptr[READ])) (fd, (char *) buf, nbytes);
 }
 
 /* write()
@@ -388,58 +762,73 @@ int32_t write (int32_t fd, const void* buf, int32_t nbytes){
         return -1;
     }
 
-    /* Get current PCB */
-    PCB * get_pcb = (PCB *) (_8MB - _8KB*(pid + 1));
+    /* Get the current process's descriptor */
+    file_desc_t * file = get_file(fd);
 
     /* Ensure pcb entry for fd is valid */
-    if(get_pcb->file_ops[fd].func_ptr[WRITE] == NULL){
+    if(file == NULL || file->func_ptr[WRITE] == NULL){
         return -1;
     }
 
     /* Call and return helper function based on file */
-    return  ((function *)  (get_pcb->file_ops[fd].func_ptr[WRITE])) (fd, (char *) buf, nbytes);
+    return  ((function *)  (file->func_ptr[WRITE])) (fd, (char *) buf, nbytes);
 }
 
 /* open()
  * Description: System call open which opens a file for the
  *              current process if there is space available.
+ *              Use create to make a new file first.
  * Inputs: filename - name of file to open
  * Outputs: none
  * Returns: index into file array, -1 on failure
  * Side Effects: none
  */
 int32_t open (const uint8_t* filename){
-    PCB * curr = (PCB *) (_8MB - (_8KB* (pid + 1))); /* Get the current PCB */
+    PCB * curr = current_process->pcb; /* Get the current PCB */
+    file_desc_t * file; /* new descriptor */
     int index = 0; /* index into file array of PCB */
     dentry_t dentry1; /* dentry to copy file information into */
     dentry_t * dentry = &dentry1;
     int ret;
-  
-    /* Read dentry of file into dentry */
-    ret = read_dentry_by_name(filename, dentry);
+    int filetype;
 
-    if(ret != 0){
+    if(filename == NULL || filename[0] == '\0') {
         return -1;
     }
 
-    int filetype = dentry->f_type;
+    /* the memory statistics pseudo-file has no dentry */
+    if(strncmp((const int8_t *) filename, MEMSTAT_NAME, sizeof(MEMSTAT_NAME)) == 0) {
+        filetype = MEMSTAT_TYPE;
+    } else {
+        /* Read dentry of file into dentry */
+        ret = read_dentry_by_name(filename, dentry);
+        if(ret != 0){
+            return -1;
+        }
+
+        filetype = dentry->f_type;
+    }
 
     /* look for open space in file array and copy information */
     while(index < MAX_FILES){
-        if(curr->file_ops[index].flags == NOT_IN_USE){
-            curr->file_ops[index].flags = IN_USE;
-            curr->file_ops[index].func_ptr = table_list[filetype];
-            ret = ((function *) curr->file_ops[index].func_ptr[OPEN]) (filename);
+        if(curr->file_ops[index] == NULL){
+            file = kmem_cache_alloc(&fd_cache);
+            if (file == NULL) {
+                return -1;
+            }
+            file->func_ptr = table_list[filetype];
+            ret = ((function *) file->func_ptr[OPEN]) (filename);
             if (ret != 0) {
+                kmem_cache_free(&fd_cache, file);
                 return -1; 
             }
             if(filetype == EXEC_TYPE) {
-                curr->file_ops[index].inode = dentry->inode;
+                file->inode = dentry->inode;
+                /* cache the file's block runs so reads don't walk data_block[] */
+                ret = build_extents(dentry->inode, &(file->extents));
+                debugf("open %s: fd %d, %d extents\n", filename, index, ret);
             } 
-            else {
-                curr->file_ops[index].inode = START;
-            }
-            curr->file_ops[index].file_pos = START;
+            curr->file_ops[index] = file;
             return index; /* Return index where file is in array */
         }
         index++;
@@ -465,9 +854,10 @@ int32_t close (int32_t fd){
     /* get current PCB */
     PCB * curr = current_process->pcb;
 
-    /* Look for file and mark as closed if opened */
-    if(curr->file_ops[fd].flags == IN_USE){
-        curr->file_ops[fd].flags = NOT_IN_USE;
+    /* Look for file and give its descriptor back if opened */
+    if(curr->file_ops[fd] != NULL){
+        kmem_cache_free(&fd_cache, curr->file_ops[fd]);
+        curr->file_ops[fd] = NULL;
         return 0;
     }
 
@@ -508,6 +898,122 @@ int32_t getargs (uint8_t* buf, int32_t nbytes){
     return 0;
 }
 
+/* getdents()
+ * Description: System call that fills the input buffer with as many
+ *              directory entries (name, type and length) as fit, so a
+ *              directory can be listed in a few calls instead of one per file.
+ * Inputs: fd - index into current PCB's file array, must be a directory
+ *         buf - user buffer of dirent_t
+ *         nbytes - size of buf in bytes
+ * Outputs: none
+ * Returns: number of bytes filled (a multiple of sizeof(dirent_t)),
+ *          0 at the end of the directory, -1 on failure
+ * Side Effects: Advances the descriptor's position past the returned entries
+ */
+int32_t getdents(int32_t fd, void * buf, int32_t nbytes) {
+    /* ensure fd is valid */
+    if(fd < MIN_FILES || fd >= MAX_FILES || buf == NULL || nbytes < (int32_t) sizeof(dirent_t)) {
+        return -1;
+    }
+
+    /* get the current process's descriptor */
+    file_desc_t * file = get_file(fd);
+
+    /* only directories have entries */
+    if(file == NULL || file->func_ptr != dir_jmp) {
+        return -1;
+    }
+    return read_dirents(&(file->file_pos), (dirent_t *) buf, nbytes / sizeof(dirent_t)) * sizeof(dirent_t);
+}
+
+/* lseek()
+ * Description: System call which moves the position the next read of
+ *              fd starts at, so programs can jump straight to an offset.
+ * Inputs: fd - index into current PCB's file array
+ *         offset - new position, relative to whence
+ *         whence - SEEK_SET, SEEK_CUR or SEEK_END
+ * Outputs: none
+ * Returns: new position, -1 on failure or if the file type can't seek
+ * Side Effects: none
+ */
+int32_t lseek(int32_t fd, int32_t offset, int32_t whence) {
+    /* ensure fd is valid */
+    if(fd < MIN_FILES || fd >= MAX_FILES) {
+        return -1;
+    }
+
+    /* get the current process's descriptor */
+    file_desc_t * file = get_file(fd);
+
+    /* make sure pcb entry for fd is valid and can seek */
+    if(file == NULL || file->func_ptr[LSEEK] == NULL) {
+        return -1;
+    }
+    return ((function *) (file->func_ptr[LSEEK])) (fd, offset, whence);
+}
+
+/* pread()
+ * Description: System call which reads from a given offset of fd
+ *              without moving the descriptor's position.
+ * Inputs: fd     - index into current PCB's file array
+ *         buf    - location to read file data to
+ *         nbytes - number of bytes to read
+ *         offset - position to read from
+ * Outputs: none
+ * Returns: number of bytes read, -1 on failure or if the file type can't seek
+ * Side Effects: none
+ */
+int32_t pread(int32_t fd, void * buf, int32_t nbytes, int32_t offset) {
+    uint32_t saved_pos;
+    int32_t ret;
+
+    /* ensure fd is valid */
+    if(fd < MIN_FILES || fd >= MAX_FILES || buf == NULL) {
+        return -1;
+    }
+
+    /* get the current process's descriptor */
+    file_desc_t * file = get_file(fd);
+
+    if(file == NULL || file->func_ptr[LSEEK] == NULL || file->func_ptr[READ] == NULL) {
+        return -1;
+    }
+
+    /* read at offset with the type's own read, then put the position back */
+    saved_pos = file->file_pos;
+    if(((function *) (file->func_ptr[LSEEK])) (fd, offset, SEEK_SET) == -1) {
+        return -1;
+    }
+    ret = ((function *) (file->func_ptr[READ])) (fd, (char *) buf, nbytes);
+    file->file_pos = saved_pos;
+    return ret;
+}
+
+/* set_handler()
+ * Description: Placeholder for the set_handler system call number user
+ *              programs know about. Signals are not supported.
+ * Inputs: signum - signal to handle
+ *         handler_address - user function to run for it
+ * Outputs: none
+ * Returns: -1
+ * Side Effects: none
+ */
+int32_t set_handler(int32_t signum, void * handler_address) {
+    return -1;
+}
+
+/* sigreturn()
+ * Description: Placeholder for the sigreturn system call number user
+ *              programs know about. Signals are not supported.
+ * Inputs: none
+ * Outputs: none
+ * Returns: -1
+ * Side Effects: none
+ */
+int32_t sigreturn(void) {
+    return -1;
+}
+
 /* vidmap()
  * Description: Maps input user pointer to start of video memory.
  * Inputs: screen_start - pointer to set
@@ -521,112 +1027,197 @@ int32_t vidmap (uint8_t** screen_start){
         return -1;
     }
 
-    /* Change necessary paging and flush the TLB afterwards */
-    Page_Directory[USR_VIDEO_PDE] = ((uint32_t) Page_Table) | PRESENT | R_W | User_SUP;
-    /* if vidmap called on currently visible terminal, associate Page_Table[PTE] with displayed video mem */
-    if(current_process && current_process->terminal->tid == curr_tid) {
-        Page_Table[VIDEO_PTE] = (uint32_t)video_mem | PRESENT | R_W | User_SUP;
-    }
-    else {
-        /* otherwise associate it with the background terminal's vmem buffer */
-        Page_Table[VIDEO_PTE] = (uint32_t)(current_process->terminal->vmem) | PRESENT | R_W | User_SUP;
-    }
-    flush_TLB();
+    /* Map the terminal's video page, which start_terminal points at displayed video mem
+     * or the terminal's vmem buffer, into this process only and drop the old translation */
+    map_user_video(pid, current_process->terminal->tid);
+    tlb_invalidate(_128MB + _4MB);
 
     *screen_start = (uint8_t*) (_128MB + _4MB); 
     return 0;
 }
 
-/* vmap()
- * Description: Maps an input process and virtual address
- *              to a page in the pd
- * Inputs: vaddr - virtual address
- *         pid - pid of process being mapped
+/* pcb_ctor()
+ * Description: Constructor for pcb_cache, gives a PCB stdin and stdout
+ *              and no other open files.
+ * Inputs: obj - PCB being handed out
  * Outputs: none
- * Returns: 0 on success, -1 on failure
- * Side Effects: Overwrites current page for given pid
+ * Returns: none
+ * Side Effects: none
  */
-int vmap(uint32_t vaddr, uint32_t pid_) {
-    /* calculate phys addr based on vaddr and pid */
-    /* right shift 22 to get top 10 msb as index into page_directory */
-    uint32_t temp = vaddr >> 22;
-    uint32_t paddr = pid_ * _4MB + _8MB;
-    
-    /* Map phys addr to page and flush the TLB afterwards */
-    Page_Directory[temp] = paddr | PRESENT | R_W | PS | User_SUP;
-    flush_TLB();
+static void pcb_ctor(void * obj) {
+    PCB * pcb = (PCB *) obj;
+    int j;
 
-    return 0;
+    /* All processes have at least standard in and standard out open intially */
+    pcb->file_ops[STD_IN] = &stdin_desc;
+    pcb->file_ops[STD_OUT] = &stdout_desc;
+    /* All other files are not in use upon init */
+    for(j = STD_OUT + 1; j < MAX_FILES; j++) {
+        pcb->file_ops[j] = NULL;
+    }
+    /* Make sure there's no garbage in the PCB's command line buffer */
+    clear_buffer(pcb->cmd_line, MAX_BUFF_LEN);
+}
+
+/* process_ctor()
+ * Description: Constructor for process_cache, clears the scheduler entry.
+ * Inputs: obj - process_t being handed out
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+static void process_ctor(void * obj) {
+    memset(obj, 0, sizeof(process_t));
+}
+
+/* fd_ctor()
+ * Description: Constructor for fd_cache, starts a descriptor at position 0
+ *              with no inode and no extent map.
+ * Inputs: obj - file_desc_t being handed out
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+static void fd_ctor(void * obj) {
+    file_desc_t * file = (file_desc_t *) obj;
+    file->inode = START;
+    file->file_pos = START;
+    file->extents.count = 0;
+}
+
+/* init_process_caches()
+ * Description: Sets up the object caches PCBs, scheduler entries and file
+ *              descriptors are allocated from.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: The kernel heap must be initialized
+ */
+void init_process_caches() {
+    kmem_cache_init(&pcb_cache, "pcb", sizeof(PCB), pcb_ctor);
+    kmem_cache_init(&process_cache, "process", sizeof(process_t), process_ctor);
+    kmem_cache_init(&fd_cache, "file_desc", sizeof(file_desc_t), fd_ctor);
+}
+
+/* get_file()
+ * Description: Looks up an open descriptor of the current process.
+ * Inputs: fd - index into current PCB's file array
+ * Outputs: none
+ * Returns: the descriptor, NULL if fd is out of range or not open
+ * Side Effects: none
+ */
+file_desc_t * get_file(int32_t fd) {
+    if(fd < MIN_FILES || fd >= MAX_FILES || current_process->pcb == NULL) {
+        return NULL;
+    }
+    return current_process->pcb->file_ops[fd];
 }
 
 /* createPCB()
  * Description: Create a PCB with the lowest available pid
  * Inputs: none
  * Outputs: none
- * Returns: pointer to new PCB
- * Side Effects: Overwrites old data at that pid's PCB location
+ * Returns: pointer to new PCB, NULL if every pid is taken or no memory is left
+ * Side Effects: Sets pid to the new process's pid
  */
 PCB * createPCB() {
     /* Get new pid and ensure its validity */
-    int8_t temp_pid = pid;
-    int8_t temp = get_pid();
+    int32_t temp = get_pid();
     if(temp == -1) {
         return NULL;
     }
-    /* Set current pid to new pid */ 
-    pid = temp;    
-
-    /* Calculate location of pcb based on pid */
-    PCB * pcb = (PCB *) (_8MB - _8KB*(pid + 1));
+    PCB * pcb = kmem_cache_alloc(&pcb_cache);
+    if(pcb == NULL) {
+        put_pid(temp);
+        return NULL;
+    }
 
     /* Fill pcb with relevant values */
-    pcb->pid = pid;
+    pcb->pid = temp;
 
     /* The first base shell's pcb parents are themselves */
-    if(pid < MAX_TERMINALS) {
+    if(temp < MAX_TERMINALS) {
         pcb->parent = pcb;
     }
     else {
-        pcb->parent = (PCB *) (_8MB - _8KB*(temp_pid + 1));
+        pcb->parent = current_process->pcb;
     }
-    
-    /* Init the FD array */
-    /* All processes have at least standard in and standard out open intially */
-    pcb -> file_ops[STD_IN].func_ptr = stdin_jmp; 
-    pcb -> file_ops[STD_IN].flags = IN_USE;
-    pcb -> file_ops[STD_OUT].func_ptr = stdout_jmp;
-    pcb -> file_ops[STD_OUT].flags = IN_USE;
-    int j;
-    /* All other files are not in use upon init */
-    for(j = STD_OUT + 1; j < MAX_FILES; j++) {
-        pcb->file_ops[j].func_ptr = NULL; 
-        pcb->file_ops[j].flags = NOT_IN_USE;
-    }
-    /* Make sure there's no garbage in the PCB's command line buffer */
-    clear_buffer(pcb->cmd_line, MAX_BUFF_LEN);
+
+    /* Set current pid to new pid */ 
+    pid = temp;    
     return pcb;
 }
 
+/* discard_pcb()
+ * Description: Undoes createPCB for an execute that failed part way,
+ *              handing the pid back and remapping the current process.
+ * Inputs: pcb - PCB from createPCB
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Sets pid back to the current process and flushes the TLB
+ */
+static void discard_pcb(PCB * pcb) {
+    put_pid(pcb->pid);
+    pid = current_process->pid;
+    load_page_dir(user_page_dir(pid));
+    kmem_cache_free(&pcb_cache, pcb);
+}
+
+/* discard_process()
+ * Description: Undoes an execute that failed after its process_t and
+ *              kernel stack were set up: frees them unless a restarting
+ *              base shell is reusing them, frees the new address space and
+ *              then discards the PCB.
+ * Inputs: process - process_t execute was filling in
+ *         pcb - PCB from createPCB
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Sets pid back to the current process and flushes the TLB
+ */
+static void discard_process(process_t * process, PCB * pcb) {
+    if(processes[pcb->pid] == NULL) {
+        kfree(kernel_stack(process));
+        kmem_cache_free(&process_cache, process);
+    }
+    load_page_dir(Page_Directory);
+    free_user_space(pcb->pid);
+    discard_pcb(pcb);
+}
+
 /* get_pid()
  * Description: find and return the lowest available pid
  * Inputs: none
  * Outputs: none
- * Returns: pid
- * Side Effects: none
+ * Returns: pid, -1 if every pid is taken
+ * Side Effects: Marks the pid taken
  */
-int8_t get_pid() {
-    /* Iterate through PID array and return available PID */
-    int i;
-    for(i = 0; i < MAX_PROCESSES ; i++) {
-        if(pid_list[i]== NOT_IN_USE) {
-            pid_list[i] = IN_USE;
-            return i;
+int32_t get_pid() {
+    /* skip whole words of taken pids, then find the clear bit */
+    uint32_t i, bit;
+    for(i = 0; i < MAX_PROCESSES / PID_BITS; i++) {
+        if(pid_map[i] != PID_WORD_FULL) {
+            for(bit = 0; pid_map[i] & (1 << bit); bit++);
+            pid_map[i] |= 1 << bit;
+            return i * PID_BITS + bit;
         }
     }
     /* Return -1 if none are available and maxes processes are in progress */
     return -1;
 }
 
+/* put_pid()
+ * Description: Hands a pid from get_pid back.
+ * Inputs: pid_ - pid to free
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void put_pid(uint32_t pid_) {
+    if(pid_ < MAX_PROCESSES) {
+        pid_map[pid_ / PID_BITS] &= ~(1 << (pid_ % PID_BITS));
+    }
+}
+
 /* parse()
  * Description: Fill a buffer with all of the arguments corresponding
  *              to a command.
@@ -661,15 +1252,80 @@ void parse(const uint8_t * buf, uint8_t * buf2, int i, int length) {
     }
 }
 
-void *mmap(void *addr, int32_t length, int32_t prot, int32_t flags, int32_t fd, int32_t offset) {
-    int i;
-    for(i = 0; i < PDE_SIZE; i++) {
-        if (i != USR_VIDEO_PDE && (Page_Directory[i] & PRESENT == 0)) {
-            /* Found a free page, mark it as present/user/4MB and return the page */
-            Page_Directory[i] |= PRESENT;
-            Page_Directory[i] |= User_SUP; 
-            Page_Directory[i] |= PS; 
-            return (void *) (Page_Directory[i] & 0xFFFFF000); 
+/* mmap()
+ * Description: Maps zero filled memory or a file into the current process's
+ *              mmap window. Pages are only filled in when first touched.
+ * Inputs: addr - where the caller would like the mapping, only a hint
+ *         length - bytes to map
+ *         prot - PROT_READ, PROT_WRITE. File mappings are read-only.
+ *         flags - MAP_ANONYMOUS for zero filled memory, otherwise fd is
+ *                 mapped. MAP_SHARED anonymous memory is what shm_create is for.
+ *         fd - open regular file to map, ignored for MAP_ANONYMOUS
+ *         offset - page aligned offset in the file of the first page
+ * Outputs: none
+ * Returns: user address of the mapping, MAP_FAILED on failure
+ * Side Effects: none
+ */
+void *mmap(void *addr, uint32_t length, int32_t prot, int32_t flags, int32_t fd, int32_t offset) {
+    file_desc_t * file;
+    uint32_t area = (prot & PROT_WRITE) ? VMA_WRITE : 0;
+    uint32_t inode = 0;
+    int32_t ret;
+
+    if(flags & MAP_ANONYMOUS) {
+        if(flags & MAP_SHARED) {
+            return MAP_FAILED;
+        }
+    } else {
+        file = get_file(fd);
+        if(file == NULL || file->func_ptr != table_list[EXEC_TYPE] || (area & VMA_WRITE) || offset < 0) {
+            return MAP_FAILED;
         }
+        area |= VMA_FILE;
+        inode = file->inode;
     }
-}
\ No newline at end of file
+
+    cli();
+    ret = vma_map(pid, (uint32_t) addr, length, area, inode, offset);
+    sti();
+    return (void *) ret;
+}
+
+/* munmap()
+ * Description: Unmaps part or all of one or more mmap'd areas of the
+ *              current process.
+ * Inputs: addr - page aligned start of the range
+ *         length - bytes to unmap
+ * Outputs: none
+ * Returns: 0 on success, -1 if the range isn't in the mmap window
+ * Side Effects: Frees the pages that were faulted in for the range
+ */
+int32_t munmap(void *addr, uint32_t length) {
+    int32_t ret;
+
+    cli();
+    ret = vma_unmap(pid, (uint32_t) addr, length);
+    sti();
+    return ret;
+}
+
+/* create()
+ * Description: System call that adds an empty regular file to the
+ *              directory, for open to open and write to fill.
+ * Inputs: filename - name of the new file
+ * Outputs: none
+ * Returns: 0 on success, -1 if the name is bad or taken (MEMSTAT_NAME
+ *          included), or the directory or inode table is full
+ * Side Effects: Claims a free inode and a directory entry
+ */
+int32_t create(const uint8_t * filename) {
+    int32_t ret;
+
+    if(filename == NULL || strncmp((const int8_t *) filename, MEMSTAT_NAME, sizeof(MEMSTAT_NAME)) == 0) {
+        return -1;
+    }
+    cli();
+    ret = fs_create(filename);
+    sti();
+    return (ret == -1) ? -1 : 0;
+}
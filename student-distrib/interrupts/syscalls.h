@@ -2,12 +2,14 @@
 #define SYSCALLS_H
 
 #include "../types.h"
+#include "../filesystem.h"
 
 #define _4GB 4294967296
-#define _8MB 8388608
 #define _4MB 4194304
 #define _128MB 134217728
 #define _8KB 8192
+#define KSTACK_SIZE _8KB   /* kernel stacks are kmalloc'd, so they are aligned to their size */
+#define FORK_FRAME 36      /* interrupt frame, the EDI, ESI, EBX sys_call saves and the EBP it passes, at the top of a kernel stack */
 #define EXEC_OFFSET 0x48000
 #define STD_IN 0
 #define STD_OUT 1
@@ -15,7 +17,11 @@
 #define READ 1
 #define OPEN 2
 #define CLOSE 3
-#define MAX_PROCESSES 6
+#define LSEEK 4
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+#define MAX_PROCESSES 1024   /* size of the pid space, free memory runs out well before it does */
 #define MAX_FILES 8
 #define ASCII_NEWLINE 0x0A
 #define MAX_FILE_LEN 32 
@@ -23,27 +29,62 @@
 #define NUM_OF_MAGIC_CHARS 4
 #define ASCII_DEL 0x7F
 #define INSTR_START 24
-#define IN_USE 1
-#define NOT_IN_USE 0
-#define NUM_JMP_TABLES 3
-#define NUM_OPS 4
+#define PT_LOAD 1
+#define ELF_MAX_PHDRS 16
+#define PID_BITS 32
+#define PID_WORD_FULL 0xFFFFFFFF
+#define NUM_JMP_TABLES 4
+#define NUM_OPS 5
 #define START 0
 #define MIN_FILES 0
 #define EXEC_TYPE 2
+#define DIR_TYPE 1
+#define MEMSTAT_TYPE 3   /* not a dentry type, open gives it to MEMSTAT_NAME */
 
+/* Descriptors and PCBs come from object caches, so their hot fields lead and
+ * the rarely used ones (extent runs, command line) trail behind them */
 typedef struct file_desc_t {
     uint32_t * func_ptr;            /* each file type has a standard interface       */
     uint32_t inode;                 /* index into inode array                        */
     uint32_t file_pos;              /* how "far" into a file the user is             */
-    uint32_t flags;                 /* used to mark a fd as "in use" or "not in use" */
+    extent_map_t extents;           /* runs of the file's data blocks, filled on open */
 } file_desc_t;
 
+/* ELF headers, for the loadable segments of a program */
+typedef struct elf_header_t {
+    uint8_t ident[16];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint32_t entry;                 /* at INSTR_START                                */
+    uint32_t phoff;                 /* file offset of the program headers            */
+    uint32_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;             /* size of one program header                    */
+    uint16_t phnum;                 /* number of program headers                     */
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+} elf_header_t;
+
+typedef struct elf_phdr_t {
+    uint32_t type;                  /* PT_LOAD for segments in the program's memory  */
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t memsz;                 /* bytes in memory, bss included                 */
+    uint32_t flags;
+    uint32_t align;
+} elf_phdr_t;
+
 typedef struct PCB {
-    file_desc_t file_ops[MAX_FILES]; /* stores the file descriptors associated with a process, setup/cleared upon open/close */
+	uint32_t pid;                    /* used to keep track of processes, indexes into processes array                               */
+	struct PCB * parent;             /* linked a process with its parent for context swap                                           */
 	uint32_t parent_esp;             /* ensures we can swap context properly                                                 */
     uint32_t parent_ebp; 
-	uint32_t pid;                    /* used to keep track of processes, indexes into processes array and used for pcb address math */
-	struct PCB * parent;             /* linked a process with its parent for context swap                                           */
+    file_desc_t * file_ops[MAX_FILES]; /* the process's open files, NULL when the fd is closed                                     */
     uint8_t cmd_line[MAX_BUFF_LEN];  /* Processes have different command lines (used for args)                                      */
 } PCB;
 
@@ -53,7 +94,6 @@ int total_base;      /* total base shells, used to prevent exiting from a base s
 
 /* System calls */
 extern int32_t halt(uint8_t status);
-int vmap(uint32_t vaddr, uint32_t pid_);
 extern int32_t execute(const uint8_t *);
 extern int32_t write (int32_t fd, const void* buf, int32_t nbytes);
 extern int32_t open (const uint8_t* filename);
@@ -61,11 +101,29 @@ extern int32_t getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t exec_halt(uint32_t status);
 extern int32_t close (int32_t fd);
 extern int32_t vidmap (uint8_t** screen_start);
-extern void *mmap(void *, uint32_t, int32_t, int32_t, int32_t, int32_t); 
+extern int32_t set_handler(int32_t signum, void * handler_address);
+extern int32_t sigreturn(void);
+extern int32_t getdents(int32_t fd, void * buf, int32_t nbytes);
+extern int32_t lseek(int32_t fd, int32_t offset, int32_t whence);
+extern int32_t pread(int32_t fd, void * buf, int32_t nbytes, int32_t offset);
+extern int32_t fork(void);
+extern int32_t sbrk(int32_t increment);
+extern int32_t shm_create(uint32_t key, uint32_t size);
+extern int32_t shm_attach(int32_t id);
+extern int32_t shm_detach(uint32_t addr);
+extern void *mmap(void * addr, uint32_t length, int32_t prot, int32_t flags, int32_t fd, int32_t offset);
+extern int32_t munmap(void * addr, uint32_t length);
+extern int32_t create(const uint8_t * filename);
 
 /* System call helpers */
+void init_process_caches();
 PCB * createPCB();
-int8_t get_pid();
+file_desc_t * get_file(int32_t fd);
+int32_t get_pid();
+void put_pid(uint32_t pid_);
+int32_t load_program(uint32_t inode_idx, uint32_t pid_);
+int32_t fs_lseek(int32_t fd, int32_t offset, int32_t whence);
+int32_t seek_to(file_desc_t * file, int32_t offset, int32_t whence, uint32_t end);
 extern void parse(const uint8_t * buf, uint8_t * buf2, int i, int length);
 
 #endif 
@@ -17,6 +17,12 @@
 #include "terminal.h"
 #include "devices/PIT.h"
 #include "devices/mouse.h"
+#include "devices/serial.h"
+#include "devices/ata.h"
+#include "malloc.h"
+#include "frame.h"
+#include "mmap.h"
+#include "swap.h"
 
 #define RUN_TESTS
 
@@ -149,7 +155,15 @@ void entry(unsigned long magic, unsigned long addr) {
     init_idt();       /* Init the IDT         */
     i8259_init();     /* Init the PIC         */
     init_fs();        /* Init the Filesystem  */
+    init_serial();    /* Init COM1            */
+    init_ata();       /* Find the swap disk   */
+    init_swap();
+    init_frames(mbi); /* Init the frame allocator from the memory map */
     init_paging();    /* Init Paging          */
+    init_memory();    /* Init the kernel heap */
+    init_process_caches(); /* PCB, process and fd caches */
+    init_vma_cache();
+    refill_zero_pool(ZERO_POOL_SIZE); /* so the first shells don't clear pages */
     
     init_keyboard();  /* Init the keyboard    */
     init_terminals(); /* Init the 3 terminals */
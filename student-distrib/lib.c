@@ -727,20 +727,3 @@ void hidden_vert_scroll() {
     /* Update the current processes y coordinate */
     current_process->terminal->curr_y--;
 }
-
-/* vert_scroll()
- * Description: Resets cr3 which flushes the TLB
- * Inputs: none
- * Outputs: none
- * Returns: none
- * Side Effects: none
- */
-void flush_TLB() {
-    asm volatile( "movl %%cr3, %%eax;"
-                 "movl %%eax, %%cr3;"
-                 
-                 :
-                 :
-                 : "%eax"
-                 );
-}
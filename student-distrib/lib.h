@@ -86,6 +86,18 @@ static inline uint32_t inl(port) {
     return val;
 }
 
+/* Reads the low 32 bits of the time stamp counter, used for
+ * benchmarking code paths that take well under 2^32 cycles */
+static inline uint32_t rdtsc(void) {
+    uint32_t low;
+    asm volatile ("rdtsc"
+            : "=a"(low)
+            :
+            : "edx"
+    );
+    return low;
+}
+
 /* Writes a byte to a port */
 #define outb(data, port)                \
 do {                                    \
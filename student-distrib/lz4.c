@@ -0,0 +1,78 @@
+#include "lz4.h"
+
+/* lz4_decompress()
+ * Description: Decodes one LZ4 block (the raw block format, no frame header).
+ *              Each sequence is a token, literals, then a back reference of at
+ *              least LZ4_MIN_MATCH bytes into the output; the last sequence
+ *              has literals only. Every length and offset is checked, so a
+ *              corrupt block fails instead of writing past dst.
+ * Inputs: src - compressed block
+ *         src_len - size of the compressed block
+ *         dst - buffer for the decoded data
+ *         dst_len - size of dst
+ * Outputs: none
+ * Returns: number of bytes decoded, -1 if the block is corrupt or doesn't fit
+ * Side Effects: None
+ */
+int32_t lz4_decompress(const uint8_t * src, uint32_t src_len, uint8_t * dst, uint32_t dst_len) {
+    const uint8_t * ip = src;
+    const uint8_t * iend = src + src_len;
+    uint8_t * op = dst;
+    uint8_t * oend = dst + dst_len;
+    const uint8_t * match;
+    uint32_t token, length, offset;
+
+    while(ip < iend) {
+        token = *ip++;
+
+        /* literals */
+        length = token >> LZ4_LIT_SHIFT;
+        if(length == LZ4_RUN_MASK) {
+            do {
+                if(ip == iend) {
+                    return -1;
+                }
+                length += *ip;
+            } while(*ip++ == LZ4_MORE_BYTES);
+        }
+        if(length > (uint32_t) (iend - ip) || length > (uint32_t) (oend - op)) {
+            return -1;
+        }
+        while(length--) {
+            *op++ = *ip++;
+        }
+        /* the last sequence stops after its literals */
+        if(ip == iend) {
+            break;
+        }
+
+        /* match: 2 byte little endian offset back into the output */
+        if(iend - ip < 2) {
+            return -1;
+        }
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if(offset == 0 || offset > (uint32_t) (op - dst)) {
+            return -1;
+        }
+        length = token & LZ4_RUN_MASK;
+        if(length == LZ4_RUN_MASK) {
+            do {
+                if(ip == iend) {
+                    return -1;
+                }
+                length += *ip;
+            } while(*ip++ == LZ4_MORE_BYTES);
+        }
+        length += LZ4_MIN_MATCH;
+        if(length > (uint32_t) (oend - op)) {
+            return -1;
+        }
+        /* byte at a time, the match may overlap the bytes it produces */
+        match = op - offset;
+        while(length--) {
+            *op++ = *match++;
+        }
+    }
+    return op - dst;
+}
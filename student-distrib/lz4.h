@@ -0,0 +1,13 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include "types.h"
+
+#define LZ4_MIN_MATCH 4     /* every match is at least this long, the token stores length - 4 */
+#define LZ4_RUN_MASK 0x0F   /* a 4 bit length field of 15 continues in the following bytes   */
+#define LZ4_MORE_BYTES 0xFF /* a length byte of 255 is followed by another one              */
+#define LZ4_LIT_SHIFT 4     /* literal length is the high nibble of the token                */
+
+int32_t lz4_decompress(const uint8_t * src, uint32_t src_len, uint8_t * dst, uint32_t dst_len);
+
+#endif
@@ -1,20 +1,221 @@
 #include "malloc.h"
 #include "lib.h"
-#include "page.h"
-#include "syscalls.h"
 
+/* Binary buddy allocator over [KHEAP_START, KHEAP_START + KHEAP_SIZE).
+ * Every block is a power of two in size and aligned to its size relative to
+ * the heap start, so a block's buddy is found by flipping one bit of its
+ * offset. block_order holds one byte per 32 byte unit: at the first unit of
+ * every block it is the block's order (plus KHEAP_FREE while the block is
+ * free), everywhere else it is 0. */
+static mm_node_t *free_list[KHEAP_ORDERS];
+static uint32_t free_count[KHEAP_ORDERS];
+static uint8_t block_order[KHEAP_UNITS];
+
+static uint32_t in_use;
+static uint32_t peak;
+static uint32_t requested;
+static uint32_t granted;
+static uint32_t allocs;
+static uint32_t frees;
+static uint32_t failures;
+
+/* unit_of()
+ * Description: Gives the index into block_order of a block in the heap.
+ * Inputs: block - start of the block
+ * Outputs: none
+ * Returns: the block's unit index
+ * Side Effects: none
+ */
+static inline uint32_t unit_of(void *block) {
+    return ((uint32_t) block - KHEAP_START) >> KHEAP_MIN_ORDER;
+}
+
+/* push_free()
+ * Description: Puts a block at the head of its order's free list.
+ * Inputs: block - start of the block
+ *         order - log2 of the block's size
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Overwrites the first 8 bytes of the block with list links
+ */
+static void push_free(mm_node_t *block, uint32_t order) {
+    block->prev = NULL;
+    block->next = free_list[order];
+    if (block->next != NULL) {
+        block->next->prev = block;
+    }
+    free_list[order] = block;
+    free_count[order]++;
+    block_order[unit_of(block)] = order | KHEAP_FREE;
+}
+
+/* unlink_free()
+ * Description: Takes a block off its order's free list.
+ * Inputs: block - start of the block, which must be on the list
+ *         order - log2 of the block's size
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Clears the block's order byte
+ */
+static void unlink_free(mm_node_t *block, uint32_t order) {
+    if (block->prev != NULL) {
+        block->prev->next = block->next;
+    } else {
+        free_list[order] = block->next;
+    }
+    if (block->next != NULL) {
+        block->next->prev = block->prev;
+    }
+    free_count[order]--;
+    block_order[unit_of(block)] = 0;
+}
+
+/* init_memory()
+ * Description: Puts the whole kernel heap on the free lists, using the
+ *              biggest aligned blocks that fit.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: The heap must already be mapped (init_paging)
+ */
 void init_memory() {
-    mm_node_t *root; 
-    mm_node_t *curr; 
-    int level = 0; 
-    int curr_size = _4MB;
-    int children = 1;
-    int i; 
-    curr = root;
-    while (level < MAX_DEPTH) {
-        curr->size = curr_size;
-        curr->in_use = 0; 
-        children *= 2; /* Level i has (i+1)*2 children */
-    }
-    return; 
-}
\ No newline at end of file
+    uint32_t offset = 0;
+    uint32_t order;
+
+    memset(free_list, 0, sizeof(free_list));
+    memset(free_count, 0, sizeof(free_count));
+    memset(block_order, 0, sizeof(block_order));
+    in_use = peak = requested = granted = allocs = frees = failures = 0;
+
+    while (offset + (1 << KHEAP_MIN_ORDER) <= KHEAP_SIZE) {
+        order = KHEAP_MAX_ORDER;
+        while ((offset & ((1 << order) - 1)) || offset + (1 << order) > KHEAP_SIZE) {
+            order--;
+        }
+        push_free((mm_node_t *) (KHEAP_START + offset), order);
+        offset += 1 << order;
+    }
+}
+
+/* kmalloc()
+ * Description: Allocates the smallest power of two block that holds size
+ *              bytes, splitting a bigger free block if needed.
+ * Inputs: size - bytes wanted
+ * Outputs: none
+ * Returns: pointer to the block, aligned to its size, or NULL if size is 0
+ *          or no free block is big enough
+ * Side Effects: Disables interrupts while the free lists change
+ */
+void *kmalloc(uint32_t size) {
+    uint32_t order = KHEAP_MIN_ORDER;
+    uint32_t k, flags;
+    mm_node_t *block;
+
+    if (size == 0 || size > (1 << KHEAP_MAX_ORDER)) {
+        failures++;
+        return NULL;
+    }
+    while ((1 << order) < size) {
+        order++;
+    }
+
+    cli_and_save(flags);
+    for (k = order; k <= KHEAP_MAX_ORDER && free_list[k] == NULL; k++);
+    if (k > KHEAP_MAX_ORDER) {
+        failures++;
+        restore_flags(flags);
+        return NULL;
+    }
+    block = free_list[k];
+    unlink_free(block, k);
+
+    /* give back the upper half until the block is the size we want */
+    while (k > order) {
+        k--;
+        push_free((mm_node_t *) ((uint8_t *) block + (1 << k)), k);
+    }
+    block_order[unit_of(block)] = order;
+
+    in_use += 1 << order;
+    if (in_use > peak) {
+        peak = in_use;
+    }
+    requested += size;
+    granted += 1 << order;
+    allocs++;
+    restore_flags(flags);
+    return block;
+}
+
+/* kfree()
+ * Description: Frees a block from kmalloc, merging it with its buddy for
+ *              as long as the buddy is free too.
+ * Inputs: ptr - pointer kmalloc returned, or NULL
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Pointers that aren't live kmalloc blocks are ignored, so
+ *               a double free can't corrupt the free lists
+ */
+void kfree(void *ptr) {
+    uint32_t offset = (uint32_t) ptr - KHEAP_START;
+    uint32_t order, buddy, flags;
+
+    if ((uint32_t) ptr < KHEAP_START || offset >= KHEAP_SIZE || (offset & ((1 << KHEAP_MIN_ORDER) - 1))) {
+        return;
+    }
+
+    cli_and_save(flags);
+    order = block_order[offset >> KHEAP_MIN_ORDER];
+    if (order == 0 || (order & KHEAP_FREE)) {
+        restore_flags(flags);
+        return;
+    }
+    block_order[offset >> KHEAP_MIN_ORDER] = 0;
+    in_use -= 1 << order;
+    frees++;
+
+    while (order < KHEAP_MAX_ORDER) {
+        buddy = offset ^ (1 << order);
+        if (buddy + (1 << order) > KHEAP_SIZE || block_order[buddy >> KHEAP_MIN_ORDER] != (order | KHEAP_FREE)) {
+            break;
+        }
+        unlink_free((mm_node_t *) (KHEAP_START + buddy), order);
+        offset &= ~(1 << order);
+        order++;
+    }
+    push_free((mm_node_t *) (KHEAP_START + offset), order);
+    restore_flags(flags);
+}
+
+/* kheap_stats()
+ * Description: Reports how much of the kernel heap is in use and how
+ *              fragmented the rest of it is.
+ * Inputs: stats - filled with the counters
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void kheap_stats(kheap_stats_t *stats) {
+    int32_t order;
+    uint32_t flags;
+
+    cli_and_save(flags);
+    stats->heap_size = KHEAP_SIZE;
+    stats->in_use = in_use;
+    stats->peak = peak;
+    stats->free_bytes = KHEAP_SIZE - in_use;
+    stats->largest_free = 0;
+    stats->free_blocks = 0;
+    for (order = KHEAP_MAX_ORDER; order >= KHEAP_MIN_ORDER; order--) {
+        if (stats->largest_free == 0 && free_list[order] != NULL) {
+            stats->largest_free = 1 << order;
+        }
+        stats->free_blocks += free_count[order];
+    }
+    stats->requested = requested;
+    stats->granted = granted;
+    stats->allocs = allocs;
+    stats->frees = frees;
+    stats->failures = failures;
+    restore_flags(flags);
+}
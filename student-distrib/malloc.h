@@ -3,27 +3,40 @@
 
 #include "types.h"
 
-#define MAX_DEPTH 12 
+/* The kernel heap is identity mapped by init_paging with 4 MB pages, so
+ * KHEAP_START and KHEAP_SIZE must be 4 MB aligned. Kernel stacks and page
+ * tables come from it, so its size bounds how many processes can run. */
+#define KHEAP_START     0x2000000
+#define KHEAP_SIZE      0x400000
+#define KHEAP_MIN_ORDER 5       /* smallest block is 32 bytes, enough for the free list links */
+#define KHEAP_MAX_ORDER 22      /* largest block is 4 MB                                       */
+#define KHEAP_ORDERS    (KHEAP_MAX_ORDER + 1)
+#define KHEAP_UNITS     (KHEAP_SIZE >> KHEAP_MIN_ORDER)
+#define KHEAP_FREE      0x80    /* set in a block's order byte while it is on a free list      */
 
+/* Free blocks hold their own free list links */
 typedef struct mm_node_t {
-    uint8_t *addr; 
-    uint32_t size; 
-    uint8_t in_use;
-    mm_node_t *left;
-    mm_node_t *right;     
-} mm_node_t; 
+    struct mm_node_t *prev;
+    struct mm_node_t *next;
+} mm_node_t;
 
-// typedef struct mm_region_t {
-//     uint8_t *addr; 
-//     mm_region_t *prev;
-//     mm_region_t *next; 
-//     uint8_t in_use; 
-//     uint32_t size; 
-// } mm_region_t;
+typedef struct kheap_stats_t {
+    uint32_t heap_size;         /* bytes managed by the allocator                          */
+    uint32_t in_use;            /* bytes in blocks handed out right now                    */
+    uint32_t peak;              /* high-water mark of in_use                               */
+    uint32_t free_bytes;        /* heap_size - in_use                                      */
+    uint32_t largest_free;      /* biggest block kmalloc could hand out right now          */
+    uint32_t free_blocks;       /* blocks on the free lists                                */
+    uint32_t requested;         /* bytes asked for by every kmalloc since boot             */
+    uint32_t granted;           /* bytes in the blocks those calls got back                */
+    uint32_t allocs;            /* successful kmalloc calls                                */
+    uint32_t frees;             /* kfree calls                                             */
+    uint32_t failures;          /* kmalloc calls that found no block big enough            */
+} kheap_stats_t;
 
-// uint8_t *mm_start;
-void init_memory(); 
-void *kmalloc(uint32_t); 
+void init_memory();
+void *kmalloc(uint32_t);
 void kfree(void *);
+void kheap_stats(kheap_stats_t *stats);
 
-#endif
\ No newline at end of file
+#endif
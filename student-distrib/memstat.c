@@ -0,0 +1,268 @@
+#include "memstat.h"
+#include "lib.h"
+#include "frame.h"
+#include "malloc.h"
+#include "slab.h"
+#include "page.h"
+#include "shm.h"
+#include "mmap.h"
+#include "textcache.h"
+#include "swap.h"
+#include "schedule.h"
+
+/* The memstat pseudo-file renders the kernel's memory counters as text.
+ * A read at position 0 takes a fresh report, reads after it continue the
+ * same one, so a monitor polls it by seeking back to 0 (or reopening) and
+ * reading to the end. Counters are totals since boot: rates come from the
+ * difference between two polls. */
+static int8_t report[MEMSTAT_SIZE];
+static uint32_t report_len;
+
+/* emit()
+ * Description: Appends a string to the report, cutting it at MEMSTAT_SIZE.
+ * Inputs: s - string to append
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+static void emit(const int8_t * s) {
+    while(*s != '\0' && report_len < MEMSTAT_SIZE) {
+        report[report_len++] = *s++;
+    }
+}
+
+/* emit_num()
+ * Description: Appends a number in decimal to the report.
+ * Inputs: value - number to append
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+static void emit_num(uint32_t value) {
+    int8_t buf[12];
+    emit(itoa(value, buf, 10));
+}
+
+/* render()
+ * Description: Builds the report: physical frames and the zero pool, the
+ *              kernel heap and every object cache, page table and TLB
+ *              use, shared memory, the text cache, swap, and one line
+ *              per process.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Called with interrupts off, so the counters agree
+ */
+static void render() {
+    uint32_t total, free, regions, a, b, c, d, i;
+    kheap_stats_t heap;
+    swap_stats_t swap;
+    kmem_cache_t * cache;
+    process_t * p;
+
+    report_len = 0;
+    frame_stats(&total, &free, &regions);
+    emit("frames: ");
+    emit_num(total);
+    emit(" total, ");
+    emit_num(free);
+    emit(" free, ");
+    emit_num(regions);
+    emit(" free 4 MB regions\n");
+
+    zero_pool_stats(&a, &b, &c);
+    emit("zero pool: ");
+    emit_num(a);
+    emit(" frames, ");
+    emit_num(b);
+    emit(" hits, ");
+    emit_num(c);
+    emit(" misses\n");
+
+    kheap_stats(&heap);
+    emit("kheap: ");
+    emit_num(heap.in_use >> 10);
+    emit("/");
+    emit_num(heap.heap_size >> 10);
+    emit(" KB in use, peak ");
+    emit_num(heap.peak >> 10);
+    emit(" KB, largest free ");
+    emit_num(heap.largest_free >> 10);
+    emit(" KB, ");
+    emit_num(heap.failures);
+    emit(" failed\n");
+    for(cache = kmem_cache_list(); cache != NULL; cache = cache->next) {
+        emit("slab ");
+        emit(cache->name);
+        emit(": ");
+        emit_num(cache->active);
+        emit("/");
+        emit_num(cache->total);
+        emit(" of ");
+        emit_num(cache->size);
+        emit(" B in ");
+        emit_num(cache->slabs);
+        emit(" slabs\n");
+    }
+
+    for(i = 0, a = 0; i < PTE_SIZE; i++) {
+        if(Page_Table[i] & PRESENT) {
+            a++;
+        }
+    }
+    emit("kernel page table: ");
+    emit_num(a);
+    emit(" present\n");
+    tlb_stats(&a, &b, &c);
+    emit("tlb: ");
+    emit_num(a);
+    emit(" full flushes, ");
+    emit_num(b);
+    emit(" invlpg, ");
+    emit_num(c);
+    emit(" cr3 loads\n");
+    shm_stats(&a, &b);
+    emit("shm: ");
+    emit_num(a);
+    emit(" segments, ");
+    emit_num(b);
+    emit(" pages\n");
+    text_stats(&a, &b, &c, &d);
+    emit("text cache: ");
+    emit_num(a);
+    emit(" files, ");
+    emit_num(b);
+    emit(" pages, ");
+    emit_num(c);
+    emit(" hits, ");
+    emit_num(d);
+    emit(" misses\n");
+    swap_stats(&swap);
+    emit("swap: ");
+    emit_num(swap.used);
+    emit("/");
+    emit_num(swap.slots);
+    emit(" slots, ");
+    emit_num(swap.ins);
+    emit(" ins, ");
+    emit_num(swap.outs);
+    emit(" outs, in ");
+    emit_num(swap.ins ? swap.in_kcycles / swap.ins : 0);
+    emit(" Kcycles avg ");
+    emit_num(swap.in_max >> SWAP_CYCLE_SHIFT);
+    emit(" max, out ");
+    emit_num(swap.outs ? swap.out_kcycles / swap.outs : 0);
+    emit(" Kcycles avg ");
+    emit_num(swap.out_max >> SWAP_CYCLE_SHIFT);
+    emit(" max\n");
+
+    for(i = 0; i < MAX_PROCESSES; i++) {
+        p = processes[i];
+        if(p == NULL) {
+            continue;
+        }
+        vma_stats(i, &a, &b, &c);
+        emit("pid ");
+        emit_num(i);
+        emit(" tty ");
+        emit_num(p->terminal->tid);
+        emit(": ");
+        emit_num(user_resident(i));
+        emit(" resident, ");
+        emit_num(user_swapped(i) + c);
+        emit(" swapped, ");
+        emit_num(user_pages_live(i));
+        emit(" ptes, heap ");
+        emit_num(user_heap(i) >> 10);
+        emit(" KB, ");
+        emit_num(a);
+        emit(" mmaps with ");
+        emit_num(b);
+        emit(" pages\n");
+    }
+}
+
+/* memstat_open()
+ * Description: Opens the memory statistics pseudo-file.
+ * Inputs: filename - ignored
+ * Outputs: none
+ * Returns: 0
+ * Side Effects: none
+ */
+int32_t memstat_open(const uint8_t * filename) {
+    return 0;
+}
+
+/* memstat_close()
+ * Description: Closes the memory statistics pseudo-file.
+ * Inputs: fd - ignored
+ * Outputs: none
+ * Returns: 0
+ * Side Effects: none
+ */
+int32_t memstat_close(int32_t fd) {
+    return 0;
+}
+
+/* memstat_read()
+ * Description: Copies the report into a buffer, taking a new one when the
+ *              descriptor is at position 0.
+ * Inputs: fd - descriptor of the pseudo-file
+ *         buf - buffer to fill
+ *         nbytes - size of buf
+ * Outputs: none
+ * Returns: bytes copied, 0 at the end of the report, -1 on bad arguments
+ * Side Effects: Advances the descriptor's position
+ */
+int32_t memstat_read(int32_t fd, void * buf, int32_t nbytes) {
+    file_desc_t * file = get_file(fd);
+    uint32_t flags, count;
+
+    if(file == NULL || buf == NULL || nbytes < 0) {
+        return -1;
+    }
+    cli_and_save(flags);
+    if(file->file_pos == 0) {
+        render();
+    }
+    count = (file->file_pos < report_len) ? report_len - file->file_pos : 0;
+    if(count > (uint32_t) nbytes) {
+        count = nbytes;
+    }
+    memcpy(buf, report + file->file_pos, count);
+    file->file_pos += count;
+    restore_flags(flags);
+    return count;
+}
+
+/* memstat_write()
+ * Description: The pseudo-file is read-only.
+ * Inputs: fd - ignored
+ *         buf - ignored
+ *         nbytes - ignored
+ * Outputs: none
+ * Returns: -1
+ * Side Effects: none
+ */
+int32_t memstat_write(int32_t fd, const void * buf, int32_t nbytes) {
+    return -1;
+}
+
+/* memstat_lseek()
+ * Description: Moves within the last report, seeking to 0 makes the next
+ *              read take a new one.
+ * Inputs: fd - descriptor of the pseudo-file
+ *         offset - new position, relative to whence
+ *         whence - SEEK_SET, SEEK_CUR or SEEK_END
+ * Outputs: none
+ * Returns: new position, -1 on failure
+ * Side Effects: none
+ */
+int32_t memstat_lseek(int32_t fd, int32_t offset, int32_t whence) {
+    file_desc_t * file = get_file(fd);
+
+    if(file == NULL) {
+        return -1;
+    }
+    return seek_to(file, offset, whence, report_len);
+}
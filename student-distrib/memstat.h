@@ -0,0 +1,15 @@
+#ifndef MEMSTAT_H
+#define MEMSTAT_H
+
+#include "types.h"
+
+#define MEMSTAT_NAME    "memstat"   /* opened like a file, but has no dentry */
+#define MEMSTAT_SIZE    8192        /* longer reports are cut short          */
+
+int32_t memstat_open(const uint8_t * filename);
+int32_t memstat_close(int32_t fd);
+int32_t memstat_read(int32_t fd, void * buf, int32_t nbytes);
+int32_t memstat_write(int32_t fd, const void * buf, int32_t nbytes);
+int32_t memstat_lseek(int32_t fd, int32_t offset, int32_t whence);
+
+#endif
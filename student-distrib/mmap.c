@@ -0,0 +1,398 @@
+#include "mmap.h"
+#include "page.h"
+#include "frame.h"
+#include "malloc.h"
+#include "slab.h"
+#include "lib.h"
+#include "filesystem.h"
+#include "swap.h"
+#include "interrupts/syscalls.h"
+
+/* Every process keeps its mapped areas in a list sorted by address. The
+ * window at MMAP_START gets page tables of the process's own, made the
+ * first time one of their pages faults in and hung straight off the page
+ * directory: the heap is identity mapped, so a directory entry is also the
+ * table's kernel address. */
+static vma_t * areas[MAX_PROCESSES];
+static kmem_cache_t vma_cache;
+
+/* init_vma_cache()
+ * Description: Sets up the object cache mapped areas come from.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void init_vma_cache() {
+    kmem_cache_init(&vma_cache, "vma", sizeof(vma_t), NULL);
+}
+
+/* area_table()
+ * Description: Gives the page table that maps an address of the window.
+ * Inputs: dir - the process's page directory
+ *         vaddr - address in the window
+ * Outputs: none
+ * Returns: the table, NULL if none has been made
+ * Side Effects: none
+ */
+static inline uint32_t * area_table(uint32_t * dir, uint32_t vaddr) {
+    uint32_t pde = dir[vaddr >> 22];
+    return (pde & PRESENT) ? (uint32_t *) (pde & PAGE_MASK) : NULL;
+}
+
+/* vma_map()
+ * Description: Adds an area of a process's mmap window. Nothing is mapped
+ *              until its pages are touched.
+ * Inputs: pid_ - process the area is for
+ *         addr - where the caller would like the area, 0 to let the
+ *                kernel pick. It is only a hint.
+ *         length - bytes to map, rounded up to whole pages
+ *         flags - VMA_WRITE, VMA_FILE
+ *         inode - file the pages are read from if VMA_FILE
+ *         offset - file offset of the first page, page aligned
+ * Outputs: none
+ * Returns: address of the area, -1 if the arguments are bad or there is
+ *          no room in the window
+ * Side Effects: none
+ */
+int32_t vma_map(uint32_t pid_, uint32_t addr, uint32_t length, uint32_t flags, uint32_t inode, uint32_t offset) {
+    vma_t ** link;
+    vma_t * vma;
+    uint32_t size = (length + FOURKB - 1) & PAGE_MASK;
+    uint32_t start = 0;
+
+    if(length == 0 || length > MMAP_END - MMAP_START || (offset & (FOURKB - 1))) {
+        return -1;
+    }
+
+    /* take the hint if that range is free, the first gap big enough otherwise */
+    if(addr >= MMAP_START && addr <= MMAP_END - size && !(addr & (FOURKB - 1))) {
+        for(vma = areas[pid_]; vma != NULL && vma->end <= addr; vma = vma->next);
+        if(vma == NULL || vma->start >= addr + size) {
+            start = addr;
+        }
+    }
+    if(start == 0) {
+        start = MMAP_START;
+        for(vma = areas[pid_]; vma != NULL && vma->start < start + size; vma = vma->next) {
+            start = vma->end;
+        }
+        if(start > MMAP_END - size) {
+            return -1;
+        }
+    }
+
+    vma = kmem_cache_alloc(&vma_cache);
+    if(vma == NULL) {
+        return -1;
+    }
+    vma->start = start;
+    vma->end = start + size;
+    vma->flags = flags;
+    vma->inode = inode;
+    vma->offset = offset;
+    for(link = &areas[pid_]; *link != NULL && (*link)->start < start; link = &(*link)->next);
+    vma->next = *link;
+    *link = vma;
+    return start;
+}
+
+/* vma_unmap()
+ * Description: Removes [addr, addr + length) from a process's areas,
+ *              trimming or splitting the areas it cuts through, and frees
+ *              the pages that were faulted in there and their swap slots.
+ * Inputs: pid_ - process to unmap from
+ *         addr - page aligned start of the range
+ *         length - bytes to unmap, rounded up to whole pages
+ * Outputs: none
+ * Returns: 0 on success (nothing mapped there is fine too), -1 if the
+ *          range is bad or splitting an area needs memory there isn't
+ * Side Effects: Drops the pages from the TLB if pid_ is running
+ */
+int32_t vma_unmap(uint32_t pid_, uint32_t addr, uint32_t length) {
+    uint32_t size = (length + FOURKB - 1) & PAGE_MASK;
+    uint32_t end = addr + size;
+    uint32_t vaddr, * table, * pte, * dir = user_page_dir(pid_);
+    vma_t ** link = &areas[pid_];
+    vma_t * vma, * tail;
+
+    if(length == 0 || length > MMAP_END - MMAP_START || (addr & (FOURKB - 1)) ||
+       addr < MMAP_START || addr > MMAP_END - size) {
+        return -1;
+    }
+    while((vma = *link) != NULL && vma->start < end) {
+        if(vma->end <= addr) {
+            link = &vma->next;
+        } else if(vma->start >= addr && vma->end <= end) {
+            *link = vma->next;
+            kmem_cache_free(&vma_cache, vma);
+        } else if(vma->start < addr && vma->end > end) {
+            /* the range is inside the area, which keeps its head and gets a new tail */
+            tail = kmem_cache_alloc(&vma_cache);
+            if(tail == NULL) {
+                return -1;
+            }
+            memcpy(tail, vma, sizeof(vma_t));
+            tail->start = end;
+            tail->offset += end - vma->start;
+            vma->end = addr;
+            vma->next = tail;
+            break;
+        } else if(vma->start < addr) {
+            vma->end = addr;
+            link = &vma->next;
+        } else {
+            vma->offset += end - vma->start;
+            vma->start = end;
+            break;
+        }
+    }
+
+    for(vaddr = addr; vaddr < end; vaddr += FOURKB) {
+        table = area_table(dir, vaddr);
+        if(table == NULL) {
+            continue;
+        }
+        pte = &table[(vaddr >> 12) & (PTE_SIZE - 1)];
+        if(*pte & PRESENT) {
+            free_frame(*pte & PAGE_MASK);
+        } else if(*pte & SWAPPED) {
+            swap_free(*pte >> 12);
+        }
+        *pte = R_W | User_SUP;
+    }
+    if(pid_ == pid) {
+        tlb_invalidate_range(addr, size / FOURKB);
+    }
+    return 0;
+}
+
+/* fill_area_page()
+ * Description: Backs a page of an area of the running process. A page a
+ *              file fills completely is mapped straight out of the
+ *              filesystem image when its block is page aligned, any other
+ *              page gets a frame from the zero pool with whatever part of
+ *              the file overlaps it read in.
+ * Inputs: vma - area the page is in
+ *         pte - the page's entry
+ *         vaddr - page aligned address of the page
+ * Outputs: none
+ * Returns: 0 on success, -1 if no frame is left
+ * Side Effects: Drops the page from the TLB
+ */
+static int32_t fill_area_page(vma_t * vma, uint32_t * pte, uint32_t vaddr) {
+    uint32_t offset = vma->offset + (vaddr - vma->start);
+    uint32_t access = (vma->flags & VMA_WRITE) ? R_W : 0;
+    uint32_t in_file = (vma->flags & VMA_FILE) && offset < inodes[vma->inode].length;
+    uint8_t * block;
+    uint32_t frame;
+
+    /* file areas are never writable, so the image block can't be written through */
+    if(in_file && offset + FOURKB <= inodes[vma->inode].length) {
+        block = file_block(vma->inode, offset / BLOCK_SIZE);
+        if(block != NULL && ((uint32_t) block & (FOURKB - 1)) == 0) {
+            *pte = (uint32_t) block | PRESENT | User_SUP;
+            tlb_invalidate(vaddr);
+            return 0;
+        }
+    }
+    frame = alloc_zeroed_frame();
+    if(frame == 0) {
+        return -1;
+    }
+    /* read the file in through the scratch window, read-only pages can't be written at vaddr */
+    if(in_file) {
+        Page_Table[SCRATCH_PTE] = frame | PRESENT | R_W;
+        tlb_invalidate(SCRATCH_ADDR);
+        read_data(vma->inode, offset, (uint8_t *) SCRATCH_ADDR, FOURKB);
+        Page_Table[SCRATCH_PTE] = R_W;
+        tlb_invalidate(SCRATCH_ADDR);
+    }
+
+    *pte = frame | PRESENT | User_SUP | access;
+    tlb_invalidate(vaddr);
+    return 0;
+}
+
+/* vma_fault()
+ * Description: Resolves a fault in the running process's mmap window:
+ *              pages of an area that aren't present yet are filled in or
+ *              read back from swap, and writes to copy-on-write pages a fork left behind get a
+ *              private copy.
+ * Inputs: vaddr - faulting address, inside the window
+ *         error - error code pushed by the processor
+ * Outputs: none
+ * Returns: 0 if the fault was handled, -1 if the address isn't mapped,
+ *          the area is read-only and this was a write, or memory ran out
+ * Side Effects: Makes the page table for the address on first use
+ */
+int32_t vma_fault(uint32_t vaddr, uint32_t error) {
+    uint32_t * dir = user_page_dir(pid);
+    uint32_t * table, * pte, i;
+    vma_t * vma;
+
+    for(vma = areas[pid]; vma != NULL && vma->end <= vaddr; vma = vma->next);
+    if(vma == NULL || vma->start > vaddr || ((error & PF_WRITE) && !(vma->flags & VMA_WRITE))) {
+        return -1;
+    }
+    vaddr &= PAGE_MASK;
+
+    table = area_table(dir, vaddr);
+    if(table == NULL) {
+        table = kmalloc(FOURKB);
+        if(table == NULL) {
+            return -1;
+        }
+        for(i = 0; i < PTE_SIZE; i++) {
+            table[i] = R_W | User_SUP;
+        }
+        dir[vaddr >> 22] = (uint32_t) table | PRESENT | R_W | User_SUP;
+    }
+    pte = &table[(vaddr >> 12) & (PTE_SIZE - 1)];
+
+    if(!(error & PF_PRESENT)) {
+        return (*pte & SWAPPED) ? swap_in_entry(pte, vaddr) : fill_area_page(vma, pte, vaddr);
+    }
+    if((error & PF_WRITE) && (*pte & COPY_ON_WRITE)) {
+        return copy_on_write(pte, vaddr);
+    }
+    return -1;
+}
+
+/* vma_clone()
+ * Description: Gives a forked process a copy of another's areas. Pages
+ *              already faulted in are shared copy-on-write like the rest
+ *              of the address space.
+ * Inputs: parent - process to copy
+ *         child - process that gets the copy, with a fresh address space
+ * Outputs: none
+ * Returns: 0 on success, -1 if the kernel heap is out of memory
+ * Side Effects: Drops the parent's newly read-only pages from the TLB if it is running
+ */
+int32_t vma_clone(uint32_t parent, uint32_t child) {
+    uint32_t * from = user_page_dir(parent);
+    uint32_t * to = user_page_dir(child);
+    uint32_t pde, * table;
+    vma_t * vma, ** link = &areas[child];
+
+    for(vma = areas[parent]; vma != NULL; vma = vma->next) {
+        *link = kmem_cache_alloc(&vma_cache);
+        if(*link == NULL) {
+            return -1;
+        }
+        memcpy(*link, vma, sizeof(vma_t));
+        link = &(*link)->next;
+    }
+    *link = NULL;
+
+    for(pde = MMAP_PDE; pde < MMAP_PDE + MMAP_PDES; pde++) {
+        if(!(from[pde] & PRESENT)) {
+            continue;
+        }
+        table = kmalloc(FOURKB);
+        if(table == NULL) {
+            return -1;
+        }
+        memset(table, 0, FOURKB);
+        share_page_table((uint32_t *) (from[pde] & PAGE_MASK), table, pde << 22, parent == pid);
+        to[pde] = (uint32_t) table | PRESENT | R_W | User_SUP;
+    }
+    return 0;
+}
+
+/* vma_release()
+ * Description: Frees every area of a process that is going away, with the
+ *              pages faulted in for them, their swap slots and their page
+ *              tables.
+ * Inputs: pid_ - process being torn down
+ * Outputs: none
+ * Returns: none
+ * Side Effects: pid_'s directory must not be loaded in CR3
+ */
+void vma_release(uint32_t pid_) {
+    uint32_t * dir = user_page_dir(pid_);
+    uint32_t pde, i, * table;
+    vma_t * vma;
+
+    while((vma = areas[pid_]) != NULL) {
+        areas[pid_] = vma->next;
+        kmem_cache_free(&vma_cache, vma);
+    }
+    if(dir == Page_Directory) {
+        return;
+    }
+    for(pde = MMAP_PDE; pde < MMAP_PDE + MMAP_PDES; pde++) {
+        table = area_table(dir, pde << 22);
+        if(table == NULL) {
+            continue;
+        }
+        for(i = 0; i < PTE_SIZE; i++) {
+            if(table[i] & PRESENT) {
+                free_frame(table[i] & PAGE_MASK);
+            } else if(table[i] & SWAPPED) {
+                swap_free(table[i] >> 12);
+            }
+        }
+        kfree(table);
+        dir[pde] = 0;
+    }
+}
+
+/* vma_maps_inode()
+ * Description: Tells whether any process has part of a file mmap'd. Such
+ *              a file must not be written: its aligned blocks are mapped
+ *              straight out of the filesystem image.
+ * Inputs: inode - inode of the file
+ * Outputs: none
+ * Returns: 1 if some process maps the file, 0 otherwise
+ * Side Effects: none
+ */
+uint32_t vma_maps_inode(uint32_t inode) {
+    uint32_t i;
+    vma_t * vma;
+
+    for(i = 0; i < MAX_PROCESSES; i++) {
+        for(vma = areas[i]; vma != NULL; vma = vma->next) {
+            if((vma->flags & VMA_FILE) && vma->inode == inode) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* vma_stats()
+ * Description: Reports how much of a process's mmap window is in use.
+ * Inputs: pid_ - process to look at
+ *         count - filled with the number of areas
+ *         pages - filled with the number of pages faulted in for them
+ *         swapped - filled with the number of their pages out in swap
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void vma_stats(uint32_t pid_, uint32_t * count, uint32_t * pages, uint32_t * swapped) {
+    uint32_t * dir = user_page_dir(pid_);
+    uint32_t pde, i, * table;
+    vma_t * vma;
+
+    *count = 0;
+    *pages = 0;
+    *swapped = 0;
+    for(vma = areas[pid_]; vma != NULL; vma = vma->next) {
+        (*count)++;
+    }
+    if(dir == Page_Directory) {
+        return;
+    }
+    for(pde = MMAP_PDE; pde < MMAP_PDE + MMAP_PDES; pde++) {
+        table = area_table(dir, pde << 22);
+        for(i = 0; table != NULL && i < PTE_SIZE; i++) {
+            if(table[i] & PRESENT) {
+                (*pages)++;
+            } else if(table[i] & SWAPPED) {
+                (*swapped)++;
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef MMAP_H
+#define MMAP_H
+
+#include "types.h"
+
+#define MMAP_PDE        35                  /* mmap window from 140 MB, 140 / 4MB = 35 */
+#define MMAP_PDES       29                  /* up to 256 MB                            */
+#define MMAP_START      (MMAP_PDE << 22)
+#define MMAP_END        ((MMAP_PDE + MMAP_PDES) << 22)
+
+/* mmap arguments, the values user programs pass */
+#define PROT_READ       0x1
+#define PROT_WRITE      0x2
+#define MAP_SHARED      0x1
+#define MAP_PRIVATE     0x2
+#define MAP_ANONYMOUS   0x20
+#define MAP_FAILED      ((void *) -1)
+
+#define VMA_WRITE       0x1                 /* pages are writable                      */
+#define VMA_FILE        0x2                 /* pages are read from inode, else zeroed  */
+
+/* One mapped area of a process. Nothing is mapped when the area is made:
+ * vma_fault fills in its pages the first time they are touched. */
+typedef struct vma_t {
+    uint32_t start;             /* first address, page aligned                  */
+    uint32_t end;               /* address just past the area, page aligned     */
+    uint32_t flags;             /* VMA_WRITE, VMA_FILE                          */
+    uint32_t inode;             /* file the pages come from if VMA_FILE         */
+    uint32_t offset;            /* file offset of start, page aligned           */
+    struct vma_t * next;        /* the process's areas, by address              */
+} vma_t;
+
+void init_vma_cache();
+int32_t vma_map(uint32_t pid_, uint32_t addr, uint32_t length, uint32_t flags, uint32_t inode, uint32_t offset);
+int32_t vma_unmap(uint32_t pid_, uint32_t addr, uint32_t length);
+int32_t vma_fault(uint32_t vaddr, uint32_t error);
+int32_t vma_clone(uint32_t parent, uint32_t child);
+void vma_release(uint32_t pid_);
+uint32_t vma_maps_inode(uint32_t inode);
+void vma_stats(uint32_t pid_, uint32_t * count, uint32_t * pages, uint32_t * swapped);
+
+#endif
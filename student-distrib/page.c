@@ -1,4 +1,52 @@
 #include "page.h"
+#include "lib.h"
+#include "interrupts/syscalls.h"
+#include "malloc.h"
+#include "frame.h"
+#include "terminal.h"
+#include "filesystem.h"
+#include "shm.h"
+#include "mmap.h"
+#include "textcache.h"
+#include "swap.h"
+
+/* Every process maps its 4 MB at 128 MB through its own page table. Pages
+ * start out not present and are filled in by handle_page_fault the first
+ * time they are touched: from the executable (mapped straight out of the
+ * filesystem image when possible, else from the text cache, either way
+ * shared copy-on-write by every process running it) or zeroed for the
+ * stack and bss. When RAM runs out, swap_out_page writes pages a process
+ * owns out to the swap disk and they fault back in the same way.
+ *
+ * Every process also has its own page directory. The kernel's entries (low
+ * 4 MB, the kernel page, the heap) are copied from Page_Directory and never
+ * change after init_paging, so switching processes is a single CR3 load.
+ * Both are kmalloc'd pages: the heap is identity mapped, so their virtual
+ * addresses are the physical ones CR3 and the directory need. */
+typedef struct user_space_t {
+    uint32_t * dir;     /* page directory, NULL while the pid is unused      */
+    uint32_t * table;   /* page table for the 4 MB at 128 MB                 */
+    uint32_t inode;     /* executable backing the process's program pages    */
+    uint32_t length;    /* its length, 0 when nothing is file backed         */
+    int32_t text;       /* its text cache slot, -1 if it isn't cached        */
+    uint32_t frames;    /* frames the process owns, its resident set         */
+    uint32_t swapped;   /* pages of its own written out to swap              */
+    uint32_t brk_start; /* first page after the program and its bss          */
+    uint32_t brk;       /* end of the heap sbrk has handed out               */
+} user_space_t;
+
+static user_space_t user_space[MAX_PROCESSES];
+static uint32_t clock_pid;              /* swap_out_page's clock hand: next process */
+static uint32_t clock_pde = USER_PDE;   /* its next page table, or an mmap one      */
+static uint32_t clock_index;            /* and next entry of that table             */
+
+/* The page user programs see at 132 MB after vidmap, one table per terminal:
+ * real video memory for the displayed terminal, its buffer for the others */
+static uint32_t Video_Page_Table[MAX_TERMINALS][PTE_SIZE] __attribute__((aligned(4 * PTE_SIZE)));
+
+static uint32_t tlb_full;     /* flush_TLB calls                        */
+static uint32_t tlb_targeted; /* single pages dropped with invlpg       */
+static uint32_t tlb_switches; /* CR3 loads by load_page_dir             */
 
 /* init_paging()
  * Description: Initialize and enable paging by filling the
@@ -33,23 +81,29 @@ void init_paging(){
             data |= GLOBAL;     /* Kernel should be loaded for every program */
         }
 
+        /* The kernel heap is identity mapped with 4 MB pages, kernel only */
+        if (i >= (KHEAP_START >> 22) && i < ((KHEAP_START + KHEAP_SIZE) >> 22)) {
+            data = i << 22;
+            data |= PRESENT | PS | GLOBAL;
+        }
+
         data |= R_W;  /* All entries are set to read/write mode */
         Page_Directory[i] = data;  /* Fill entry with data      */
         Page_Table[i] = FOURKB*i | R_W;  /* Fill other page table entries with address, but not present */
     }
 
     /* Video memory page in first page directory must be mapped to video memory */
-    Page_Table[VIRTUAL_VIDEO_START] = (VIRTUAL_VIDEO_START << 12) | (PRESENT) | (R_W);
+    Page_Table[VIRTUAL_VIDEO_START] = (VIRTUAL_VIDEO_START << 12) | (PRESENT) | (R_W) | GLOBAL;
 
     /* Enable paging */
     asm volatile(
                  "movl $Page_Directory, %%eax;"
                  "movl %%eax, %%cr3;" /* cr3 holds the address of our page directory */
                  "movl %%cr4, %%eax;"
-                 "orl $0x00000010, %%eax;" /* bit 5 of cr4 allows 4 mB pages */
+                 "orl $0x00000090, %%eax;" /* bit 5 of cr4 allows 4 mB pages, bit 8 keeps GLOBAL pages across CR3 loads */
                  "movl %%eax, %%cr4;"
                  "movl %%cr0, %%eax;"
-                 "orl $0x80000000, %%eax;" /* once bits are set, enable paging (msb of cr0) */
+                 "orl $0x80010000, %%eax;" /* once bits are set, enable paging (msb of cr0) and write protection (CR0_WP) */
                  "movl %%eax, %%cr0;"
                  :                      /* no outputs */
                  :                      /* no input */
@@ -57,3 +111,783 @@ void init_paging(){
                  );
 }
 
+
+/* init_user_space()
+ * Description: Gives a process an empty page table, so every page of its
+ *              4 MB at 128 MB faults in on first use, and sets up its page
+ *              directory: the kernel's entries, its page table at 128 MB
+ *              and no video page until it calls vidmap.
+ * Inputs: pid_ - process whose address space is set up
+ * Outputs: none
+ * Returns: 0 on success, -1 if the kernel heap is out of pages
+ * Side Effects: Keeps the directory and table of a pid that already has
+ *               them, the frames they mapped must be freed by free_user_space
+ */
+int32_t init_user_space(uint32_t pid_) {
+    user_space_t * space = &user_space[pid_];
+    int i;
+
+    if(space->dir == NULL) {
+        space->dir = kmalloc(FOURKB);
+        space->table = kmalloc(FOURKB);
+        if(space->dir == NULL || space->table == NULL) {
+            kfree(space->dir);
+            kfree(space->table);
+            space->dir = NULL;
+            space->table = NULL;
+            return -1;
+        }
+    }
+    for(i = 0; i < PTE_SIZE; i++) {
+        space->table[i] = R_W | User_SUP;
+    }
+    space->inode = 0;
+    space->length = 0;
+    space->text = -1;
+    space->frames = 0;
+    space->swapped = 0;
+    space->brk_start = 0;
+    space->brk = 0;
+    memcpy(space->dir, Page_Directory, sizeof(Page_Directory));
+    space->dir[USER_PDE] = (uint32_t) space->table | PRESENT | R_W | User_SUP;
+    space->dir[USR_VIDEO_PDE] = R_W;
+    return 0;
+}
+
+/* set_user_image()
+ * Description: Records the executable that backs a process's pages from
+ *              0x8048000 on, for handle_page_fault to load them from, and
+ *              starts the process's heap on the page after the program.
+ *              The executable joins the text cache if there is room.
+ * Inputs: pid_ - process being loaded
+ *         inode_idx - inode of the executable
+ *         length - bytes of the file that are mapped
+ *         end - user address just past the program's bss
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void set_user_image(uint32_t pid_, uint32_t inode_idx, uint32_t length, uint32_t end) {
+    user_space_t * space = &user_space[pid_];
+
+    text_put(space->text);
+    space->inode = inode_idx;
+    space->length = length;
+    space->text = text_get(inode_idx, length);
+    if(end < _128MB + EXEC_OFFSET + length) {
+        end = _128MB + EXEC_OFFSET + length;
+    }
+    space->brk_start = (end + FOURKB - 1) & PAGE_MASK;
+    space->brk = space->brk_start;
+}
+
+/* user_sbrk()
+ * Description: Moves the end of a process's heap. Pages are not mapped
+ *              here: the heap faults in zero filled like the stack does.
+ *              Pages a shrinking heap no longer covers are freed.
+ * Inputs: pid_ - process whose heap changes, the running one
+ *         increment - bytes to grow the heap by, negative to shrink it
+ * Outputs: none
+ * Returns: the old end of the heap, -1 if the heap would go below its
+ *          start or into the USER_STACK_SIZE bytes kept for the stack
+ * Side Effects: Drops freed pages from the TLB
+ */
+int32_t user_sbrk(uint32_t pid_, int32_t increment) {
+    user_space_t * space = &user_space[pid_];
+    uint32_t old = space->brk;
+    uint32_t brk = old + increment;
+    uint32_t vaddr, * pte;
+
+    if(space->brk_start == 0 || (increment > 0 && (brk < old || brk > _128MB + _4MB - USER_STACK_SIZE)) ||
+       (increment < 0 && (brk > old || brk < space->brk_start))) {
+        return -1;
+    }
+    for(vaddr = (brk + FOURKB - 1) & PAGE_MASK; vaddr < old; vaddr += FOURKB) {
+        pte = &space->table[(vaddr >> 12) & (PTE_SIZE - 1)];
+        if(*pte & PRESENT) {
+            free_frame(*pte & PAGE_MASK);
+            space->frames--;
+            *pte = R_W | User_SUP;
+            tlb_invalidate(vaddr);
+        } else if(*pte & SWAPPED) {
+            swap_free(*pte >> 12);
+            space->swapped--;
+            *pte = R_W | User_SUP;
+        }
+    }
+    space->brk = brk;
+    return old;
+}
+
+/* user_resident()
+ * Description: Gives the number of frames a process has faulted in.
+ *              Pages still shared with the filesystem image don't count.
+ * Inputs: pid_ - process to look at
+ * Outputs: none
+ * Returns: resident frames
+ * Side Effects: none
+ */
+uint32_t user_resident(uint32_t pid_) {
+    return user_space[pid_].frames;
+}
+
+/* user_swapped()
+ * Description: Gives the number of a process's pages that are out in swap.
+ * Inputs: pid_ - process to look at
+ * Outputs: none
+ * Returns: swapped out pages
+ * Side Effects: none
+ */
+uint32_t user_swapped(uint32_t pid_) {
+    return user_space[pid_].swapped;
+}
+
+/* user_pages_live()
+ * Description: Counts the present entries of a process's page table,
+ *              its own frames and the pages it shares alike.
+ * Inputs: pid_ - process to look at
+ * Outputs: none
+ * Returns: present entries, 0 if the pid has no address space
+ * Side Effects: none
+ */
+uint32_t user_pages_live(uint32_t pid_) {
+    uint32_t i, live = 0;
+
+    if(user_space[pid_].table == NULL) {
+        return 0;
+    }
+    for(i = 0; i < PTE_SIZE; i++) {
+        if(user_space[pid_].table[i] & PRESENT) {
+            live++;
+        }
+    }
+    return live;
+}
+
+/* user_image_busy()
+ * Description: Tells whether any process runs an executable. Such a file
+ *              must not be written: its pages are mapped straight out of
+ *              the filesystem image or shared through the text cache.
+ * Inputs: inode - inode of the file
+ * Outputs: none
+ * Returns: 1 if some process runs the file, 0 otherwise
+ * Side Effects: none
+ */
+uint32_t user_image_busy(uint32_t inode) {
+    uint32_t i;
+
+    for(i = 0; i < MAX_PROCESSES; i++) {
+        if(user_space[i].dir != NULL && user_space[i].length != 0 && user_space[i].inode == inode) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* user_heap()
+ * Description: Gives the size of a process's sbrk heap.
+ * Inputs: pid_ - process to look at
+ * Outputs: none
+ * Returns: bytes between the start and the end of the heap
+ * Side Effects: none
+ */
+uint32_t user_heap(uint32_t pid_) {
+    return user_space[pid_].brk - user_space[pid_].brk_start;
+}
+
+/* map_user_video()
+ * Description: Maps the video page of a terminal at 132 MB for a process.
+ * Inputs: pid_ - process calling vidmap
+ *         tid - terminal the process runs in
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Caller must flush the TLB if pid_ is the running process
+ */
+void map_user_video(uint32_t pid_, uint32_t tid) {
+    user_space[pid_].dir[USR_VIDEO_PDE] = (uint32_t) Video_Page_Table[tid] | PRESENT | R_W | User_SUP;
+}
+
+/* map_terminal_video()
+ * Description: Points a terminal's user video page at real video memory or
+ *              at the terminal's buffer.
+ * Inputs: tid - terminal to remap
+ *         paddr - VIDEO_MEMORY_START or the terminal's vmem buffer
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Caller must flush the TLB
+ */
+void map_terminal_video(uint32_t tid, uint32_t paddr) {
+    Video_Page_Table[tid][VIDEO_PTE] = (paddr & PAGE_MASK) | PRESENT | R_W | User_SUP;
+}
+
+/* user_page_dir()
+ * Description: Gives a process's page directory.
+ * Inputs: pid_ - process whose directory is wanted
+ * Outputs: none
+ * Returns: the page directory, for load_page_dir, or Page_Directory if the
+ *          pid has no address space (the boot process before the first shell)
+ * Side Effects: none
+ */
+uint32_t * user_page_dir(uint32_t pid_) {
+    if(pid_ >= MAX_PROCESSES || user_space[pid_].dir == NULL) {
+        return Page_Directory;
+    }
+    return user_space[pid_].dir;
+}
+
+/* load_page_dir()
+ * Description: Switches address spaces by loading a page directory into
+ *              CR3. GLOBAL kernel pages stay in the TLB.
+ * Inputs: dir - Page_Directory or a directory from user_page_dir
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Flushes the TLB's non-global entries
+ */
+void load_page_dir(uint32_t * dir) {
+    tlb_switches++;
+    asm volatile("movl %0, %%cr3;"
+                 :
+                 : "r"(dir)
+                 : "memory"
+                 );
+}
+
+/* flush_TLB()
+ * Description: Reloads CR3, dropping every non-global TLB entry. Only for
+ *              changes too big for tlb_invalidate_range.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void flush_TLB() {
+    tlb_full++;
+    asm volatile( "movl %%cr3, %%eax;"
+                 "movl %%eax, %%cr3;"
+                 
+                 :
+                 :
+                 : "%eax"
+                 );
+}
+
+/* tlb_invalidate()
+ * Description: Drops the TLB entry for one page after its mapping changed.
+ *              Works for 4 KB pages and 4 MB pages, GLOBAL or not, and
+ *              for a changed page directory entry whose table maps vaddr.
+ * Inputs: vaddr - any address inside the page
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void tlb_invalidate(uint32_t vaddr) {
+    tlb_targeted++;
+    asm volatile("invlpg (%0);"
+                 :
+                 : "r"(vaddr)
+                 : "memory"
+                 );
+}
+
+/* tlb_invalidate_range()
+ * Description: Drops the TLB entries of a run of 4 KB pages, falling back
+ *              to a full flush when the run is long enough that invlpg on
+ *              every page would cost more.
+ * Inputs: vaddr - first page of the run
+ *         pages - number of pages
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void tlb_invalidate_range(uint32_t vaddr, uint32_t pages) {
+    uint32_t i;
+
+    if(pages > TLB_RANGE_MAX) {
+        flush_TLB();
+        return;
+    }
+    for(i = 0; i < pages; i++) {
+        tlb_invalidate(vaddr + i * FOURKB);
+    }
+}
+
+/* tlb_stats()
+ * Description: Reports how the TLB has been flushed since boot.
+ * Inputs: full - filled with the number of full flushes
+ *         targeted - filled with the number of single page invalidations
+ *         switches - filled with the number of address space switches
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void tlb_stats(uint32_t * full, uint32_t * targeted, uint32_t * switches) {
+    *full = tlb_full;
+    *targeted = tlb_targeted;
+    *switches = tlb_switches;
+}
+
+/* free_user_space()
+ * Description: Gives every frame a process faulted in back to the frame
+ *              allocator, detaches its shared memory and mappings, then
+ *              frees its page table and directory. Frames
+ *              a forked process still shares only lose a reference and
+ *              pages of the filesystem image are just dropped.
+ * Inputs: pid_ - process whose memory is freed
+ * Outputs: none
+ * Returns: none
+ * Side Effects: pid_'s directory must not be loaded in CR3. Loading another
+ *               one already flushed its pages from the TLB.
+ */
+void free_user_space(uint32_t pid_) {
+    user_space_t * space = &user_space[pid_];
+    uint32_t i;
+
+    if(space->dir == NULL) {
+        return;
+    }
+    for(i = 0; i < PTE_SIZE; i++) {
+        if(space->table[i] & PRESENT) {
+            free_frame(space->table[i] & PAGE_MASK);
+        } else if(space->table[i] & SWAPPED) {
+            swap_free(space->table[i] >> 12);
+        }
+    }
+    shm_release(pid_);
+    vma_release(pid_);
+    text_put(space->text);
+    kfree(space->table);
+    kfree(space->dir);
+    memset(space, 0, sizeof(user_space_t));
+}
+
+/* clone_user_space()
+ * Description: Gives a process a copy-on-write copy of another's address
+ *              space: every present page is mapped into both, read-only,
+ *              and copied by handle_page_fault when either side writes.
+ *              Pages that aren't present yet fault in on their own from
+ *              the same executable. Shared memory stays shared and
+ *              mmap'd areas are copied the same way.
+ * Inputs: parent - process to copy
+ *         child - process that gets the copy
+ * Outputs: none
+ * Returns: 0 on success, -1 if the kernel heap is out of pages
+ * Side Effects: Drops the parent's newly read-only pages from the TLB if it is running
+ */
+int32_t clone_user_space(uint32_t parent, uint32_t child) {
+    user_space_t * from = &user_space[parent];
+    user_space_t * to = &user_space[child];
+
+    if(init_user_space(child) == -1 || shm_clone(parent, child) == -1 || vma_clone(parent, child) == -1) {
+        return -1;
+    }
+    to->inode = from->inode;
+    to->length = from->length;
+    to->text = (from->text == -1) ? -1 : text_get(from->inode, from->length);
+    to->frames = from->frames;
+    to->swapped = from->swapped;
+    to->brk_start = from->brk_start;
+    to->brk = from->brk;
+    to->dir[USR_VIDEO_PDE] = from->dir[USR_VIDEO_PDE];
+
+    share_page_table(from->table, to->table, USER_PDE << 22, parent == pid);
+    return 0;
+}
+
+/* zero_frame()
+ * Description: Clears a frame that isn't mapped anywhere, through the
+ *              scratch window.
+ * Inputs: paddr - physical address of the frame
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Interrupts must be off, the scratch window is shared
+ */
+void zero_frame(uint32_t paddr) {
+    Page_Table[SCRATCH_PTE] = (paddr & PAGE_MASK) | PRESENT | R_W;
+    tlb_invalidate(SCRATCH_ADDR);
+    memset((void *) SCRATCH_ADDR, 0, FOURKB);
+    Page_Table[SCRATCH_PTE] = R_W;
+    tlb_invalidate(SCRATCH_ADDR);
+}
+
+/* share_page_table()
+ * Description: Copies the present entries of one page table into another
+ *              for fork. Writable pages become read-only and copy-on-write
+ *              in both tables and every frame gets one more reference.
+ *              Swapped out pages are copied too, each side reads its own
+ *              copy back in.
+ * Inputs: from - table to copy
+ *         to - empty table that gets the copy
+ *         vaddr - user address the tables map from
+ *         running - 1 if from belongs to the running process
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Drops the newly read-only pages from the TLB if running
+ */
+void share_page_table(uint32_t * from, uint32_t * to, uint32_t vaddr, uint32_t running) {
+    uint32_t i, pte, protected = 0;
+
+    for(i = 0; i < PTE_SIZE; i++) {
+        pte = from[i];
+        if(!(pte & PRESENT)) {
+            if(pte & SWAPPED) {
+                swap_dup(pte >> 12);
+                to[i] = pte;
+            }
+            continue;
+        }
+        if(pte & R_W) {
+            pte = (pte & ~R_W) | COPY_ON_WRITE;
+            from[i] = pte;
+            protected++;
+            if(running && protected <= TLB_RANGE_MAX) {
+                tlb_invalidate(vaddr + i * FOURKB);
+            }
+        }
+        share_frame(pte & PAGE_MASK);
+        to[i] = pte;
+    }
+    if(running && protected > TLB_RANGE_MAX) {
+        flush_TLB();
+    }
+}
+
+/* map_user_page()
+ * Description: Maps one 4 KB page of a process's 4 MB user region.
+ * Inputs: pid_ - process to map the page for
+ *         vaddr - user virtual address of the page
+ *         paddr - 4 KB aligned physical address to map it to
+ *         flags - PTE flags (PRESENT, R_W, User_SUP, COPY_ON_WRITE)
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Caller must flush the TLB if pid_ is the running process
+ */
+void map_user_page(uint32_t pid_, uint32_t vaddr, uint32_t paddr, uint32_t flags) {
+    /* shift 12 to get the page's index in its table */
+    user_space[pid_].table[(vaddr >> 12) & (PTE_SIZE - 1)] = (paddr & PAGE_MASK) | flags;
+}
+
+/* user_page_table()
+ * Description: Gives the page directory entry for a process's user region.
+ * Inputs: pid_ - process whose table is wanted
+ * Outputs: none
+ * Returns: address of the process's page table
+ * Side Effects: none
+ */
+uint32_t user_page_table(uint32_t pid_) {
+    return (uint32_t) user_space[pid_].table;
+}
+
+/* fill_user_page()
+ * Description: Backs a page of the running process that isn't present
+ *              yet. A page the executable fills completely is mapped
+ *              read-only and copy-on-write straight out of the filesystem
+ *              image when its block is page aligned, other pages of the
+ *              executable come from the text cache the same way. Pages
+ *              past it, or of an executable the cache has no room for, get
+ *              a frame from the zero pool with whatever part of the
+ *              executable overlaps it read in: the stack and bss stay zero.
+ * Inputs: vaddr - page aligned address of the page
+ * Outputs: none
+ * Returns: 0 on success, -1 if no frame is left
+ * Side Effects: Changes the process's page table and drops the page from the TLB
+ */
+static int32_t fill_user_page(uint32_t vaddr) {
+    user_space_t * space = &user_space[pid];
+    uint32_t * pte = &space->table[(vaddr >> 12) & (PTE_SIZE - 1)];
+    uint32_t image = _128MB + EXEC_OFFSET;
+    uint32_t offset = vaddr - image;   /* page's offset in the executable */
+    uint32_t in_file = (vaddr >= image && offset < space->length);
+    uint8_t * block;
+    uint32_t frame;
+
+    /* blocks are only page aligned if the module is (MULTIBOOT_HEADER_FLAGS asks for it),
+     * and compressed files have no blocks worth mapping */
+    if(in_file && offset + FOURKB <= space->length) {
+        block = file_block(space->inode, offset / BLOCK_SIZE);
+        if(block != NULL && ((uint32_t) block & (FOURKB - 1)) == 0) {
+            *pte = (uint32_t) block | PRESENT | User_SUP | COPY_ON_WRITE | SHARED_TEXT;
+            tlb_invalidate(vaddr);
+            return 0;
+        }
+    }
+
+    /* otherwise every process running the file shares the one copy the text cache reads in */
+    if(in_file) {
+        frame = text_frame(space->text, offset / FOURKB);
+        if(frame != 0) {
+            *pte = frame | PRESENT | User_SUP | COPY_ON_WRITE | SHARED_TEXT;
+            tlb_invalidate(vaddr);
+            return 0;
+        }
+    }
+
+    frame = alloc_zeroed_frame();
+    if(frame == 0) {
+        return -1;
+    }
+    *pte = frame | PRESENT | R_W | User_SUP;
+    space->frames++;
+    tlb_invalidate(vaddr);
+    if(in_file && read_data(space->inode, offset, (uint8_t *) vaddr, FOURKB) == -1) {
+        /* leave the page as it was, not present */
+        *pte = R_W | User_SUP;
+        space->frames--;
+        tlb_invalidate(vaddr);
+        free_frame(frame);
+        return -1;
+    }
+    return 0;
+}
+
+/* copy_on_write()
+ * Description: Resolves a write to a copy-on-write page of the running
+ *              process. A frame nobody else maps any more is just made
+ *              writable again, otherwise the page is copied into a frame
+ *              of the process's own, which is mapped read/write.
+ * Inputs: pte - the page's entry in the running process's tables
+ *         vaddr - page aligned address of the page
+ * Outputs: none
+ * Returns: 0 on success, -1 if no frame is left
+ * Side Effects: Drops the page from the TLB
+ */
+int32_t copy_on_write(uint32_t * pte, uint32_t vaddr) {
+    uint32_t shared = *pte & PAGE_MASK;
+    uint32_t frame;
+
+    if(!frame_shared(shared)) {
+        *pte = shared | PRESENT | R_W | User_SUP;
+        tlb_invalidate(vaddr);
+        return 0;
+    }
+    frame = alloc_frame();
+    if(frame == 0) {
+        return -1;
+    }
+
+    /* copy through the scratch window, the shared page stays mapped at vaddr until the copy is done */
+    Page_Table[SCRATCH_PTE] = frame | PRESENT | R_W;
+    tlb_invalidate(SCRATCH_ADDR);
+    memcpy((void *) SCRATCH_ADDR, (const void *) vaddr, FOURKB);
+    Page_Table[SCRATCH_PTE] = R_W;
+    tlb_invalidate(SCRATCH_ADDR);
+
+    *pte = frame | PRESENT | R_W | User_SUP;
+    tlb_invalidate(vaddr);
+    free_frame(shared);
+    return 0;
+}
+
+/* copy_user_page()
+ * Description: Resolves a write to a copy-on-write page of the running
+ *              process's 4 MB at 128 MB.
+ * Inputs: vaddr - page aligned address of the page
+ * Outputs: none
+ * Returns: 0 on success, -1 if no frame is left
+ * Side Effects: Changes the process's page table and drops the page from the TLB
+ */
+static int32_t copy_user_page(uint32_t vaddr) {
+    uint32_t * pte = &user_space[pid].table[(vaddr >> 12) & (PTE_SIZE - 1)];
+    uint32_t text = *pte & SHARED_TEXT;
+
+    if(copy_on_write(pte, vaddr) == -1) {
+        return -1;
+    }
+    /* a page of the executable wasn't one of the process's frames before */
+    if(text) {
+        user_space[pid].frames++;
+    }
+    return 0;
+}
+
+/* swap_in_entry()
+ * Description: Reads a swapped out page of the running process back into
+ *              a frame of its own, with the access it had.
+ * Inputs: pte - the page's entry, marked SWAPPED
+ *         vaddr - page aligned address of the page
+ * Outputs: none
+ * Returns: 0 on success, -1 if no frame is left or the disk fails
+ * Side Effects: Drops the page from the TLB
+ */
+int32_t swap_in_entry(uint32_t * pte, uint32_t vaddr) {
+    uint32_t start = rdtsc();
+    uint32_t slot = *pte >> 12;
+    uint32_t frame;
+
+    frame = alloc_frame();
+    if(frame == 0) {
+        return -1;
+    }
+    if(swap_read(slot, frame) == -1) {
+        free_frame(frame);
+        return -1;
+    }
+    *pte = frame | PRESENT | User_SUP | (*pte & (R_W | COPY_ON_WRITE));
+    swap_free(slot);
+    tlb_invalidate(vaddr);
+    swap_count_in(rdtsc() - start);
+    return 0;
+}
+
+/* swap_in_page()
+ * Description: Reads a swapped out page of the running process's 4 MB at
+ *              128 MB back in.
+ * Inputs: vaddr - page aligned address of the page
+ * Outputs: none
+ * Returns: 0 on success, -1 if no frame is left or the disk fails
+ * Side Effects: Changes the process's page table and drops the page from the TLB
+ */
+static int32_t swap_in_page(uint32_t vaddr) {
+    user_space_t * space = &user_space[pid];
+
+    if(swap_in_entry(&space->table[(vaddr >> 12) & (PTE_SIZE - 1)], vaddr) == -1) {
+        return -1;
+    }
+    space->frames++;
+    space->swapped--;
+    return 0;
+}
+
+/* clock_table()
+ * Description: Gives the page table swap_out_page's clock hand is at.
+ * Inputs: owner - process the hand is at
+ *         pde - directory entry of the table, USER_PDE or in the mmap window
+ * Outputs: none
+ * Returns: the table, NULL if the process has no address space or nothing
+ *          is mapped there yet
+ * Side Effects: none
+ */
+static uint32_t * clock_table(uint32_t owner, uint32_t pde) {
+    uint32_t * dir = user_space[owner].dir;
+
+    if(dir == NULL) {
+        return NULL;
+    }
+    if(pde == USER_PDE) {
+        return user_space[owner].table;
+    }
+    return (dir[pde] & PRESENT) ? (uint32_t *) (dir[pde] & PAGE_MASK) : NULL;
+}
+
+/* clock_next_table()
+ * Description: Moves swap_out_page's clock hand to the start of the next
+ *              table: the process's own 4 MB, then its mmap window, then
+ *              the next process. A pid without an address space is passed
+ *              in one step.
+ * Inputs: none
+ * Outputs: none
+ * Returns: 1 if the hand wrapped around to the first pid, 0 otherwise
+ * Side Effects: none
+ */
+static uint32_t clock_next_table() {
+    clock_index = 0;
+    clock_pde = (clock_pde == USER_PDE) ? MMAP_PDE : clock_pde + 1;
+    if(user_space[clock_pid].dir != NULL && clock_pde < MMAP_PDE + MMAP_PDES) {
+        return 0;
+    }
+    clock_pde = USER_PDE;
+    clock_pid = (clock_pid + 1) % MAX_PROCESSES;
+    return clock_pid == 0;
+}
+
+/* swap_out_page()
+ * Description: Frees a frame by writing a page out to swap. A clock hand
+ *              sweeps every process's 4 MB at 128 MB and mmap window: a
+ *              page used since the hand last passed (accessed bit set) has
+ *              the bit cleared and is passed over, the first one that
+ *              wasn't is written out. Only frames one page owns are taken,
+ *              never pages shared after fork or with the filesystem image
+ *              or text cache. Shared memory segments aren't swept, their
+ *              frames belong to the segment rather than a process.
+ * Inputs: none
+ * Outputs: none
+ * Returns: 1 if a frame was freed, 0 if nothing can be swapped out
+ * Side Effects: Interrupts must be off. Drops the page from the TLB if it
+ *               belongs to the running process
+ */
+uint32_t swap_out_page() {
+    uint32_t start = rdtsc();
+    uint32_t laps = 0, owner, pde, vaddr, frame;
+    uint32_t * table, * pte;
+    int32_t slot;
+
+    /* the first lap may start midway, so SWAP_SCAN_PASSES full ones take one more */
+    while(laps <= SWAP_SCAN_PASSES) {
+        owner = clock_pid;
+        pde = clock_pde;
+        table = clock_table(owner, pde);
+        if(table == NULL) {
+            laps += clock_next_table();
+            continue;
+        }
+        pte = &table[clock_index];
+        vaddr = (pde << 22) + clock_index * FOURKB;
+        if(++clock_index == PTE_SIZE) {
+            laps += clock_next_table();
+        }
+        if(!(*pte & PRESENT) || (*pte & SHARED_TEXT) || frame_shared(*pte & PAGE_MASK)) {
+            continue;
+        }
+        if(*pte & A) {
+            *pte &= ~A;
+            if(owner == pid) {
+                tlb_invalidate(vaddr);
+            }
+            continue;
+        }
+
+        slot = swap_alloc();
+        if(slot == -1) {
+            return 0;
+        }
+        frame = *pte & PAGE_MASK;
+        if(swap_write(slot, frame) == -1) {
+            swap_free(slot);
+            return 0;
+        }
+        /* keep the access bits, read-only mmap pages and copy-on-write ones come back as they were */
+        *pte = (slot << 12) | SWAPPED | User_SUP | (*pte & (R_W | COPY_ON_WRITE));
+        if(owner == pid) {
+            tlb_invalidate(vaddr);
+        }
+        if(pde == USER_PDE) {
+            user_space[owner].frames--;
+            user_space[owner].swapped++;
+        }
+        free_frame(frame);
+        swap_count_out(rdtsc() - start);
+        return 1;
+    }
+    return 0;
+}
+
+/* handle_page_fault()
+ * Description: Resolves faults in the running process's 4 MB at 128 MB,
+ *              whether user code or the kernel touched the page: pages
+ *              that aren't present yet are filled in or read back from
+ *              swap, and writes to copy-on-write pages get a private copy.
+ *              Faults in the mmap window go to vma_fault.
+ * Inputs: vaddr - faulting address (CR2)
+ *         error - error code pushed by the processor
+ * Outputs: none
+ * Returns: 0 if the fault was handled, -1 if it is a real page fault
+ * Side Effects: Changes the process's page table and drops the page from the TLB
+ */
+int32_t handle_page_fault(uint32_t vaddr, uint32_t error) {
+    uint32_t pte;
+
+    if(vaddr >= MMAP_START && vaddr < MMAP_END && pid >= 0 && pid < MAX_PROCESSES) {
+        return vma_fault(vaddr, error);
+    }
+    if((vaddr >> 22) != USER_PDE || pid < 0 || pid >= MAX_PROCESSES || user_space[pid].table == NULL) {
+        return -1;
+    }
+    pte = user_space[pid].table[(vaddr >> 12) & (PTE_SIZE - 1)];
+    vaddr &= PAGE_MASK;
+    if(!(error & PF_PRESENT)) {
+        return (pte & SWAPPED) ? swap_in_page(vaddr) : fill_user_page(vaddr);
+    }
+    if((error & PF_WRITE) && (pte & COPY_ON_WRITE)) {
+        return copy_user_page(vaddr);
+    }
+    return -1;
+}
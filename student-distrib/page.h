@@ -14,14 +14,51 @@
 #define A        0x20
 #define PS       0x80
 #define GLOBAL   0x100
+#define COPY_ON_WRITE 0x200 /* available bit: read-only PTE that gets a private copy of its page when written */
+#define SHARED_TEXT 0x400   /* available bit: page of the executable every process running it maps, not one of its frames */
+#define SWAPPED 0x800       /* available bit: entry isn't present, bits 12-31 hold the swap slot of its page */
+#define PAGE_MASK 0xFFFFF000
+#define PF_PRESENT 0x1      /* page fault error code: the page was present (protection fault) */
+#define PF_WRITE   0x2      /* page fault error code: the access was a write                  */
+#define CR0_WP   0x10000    /* makes the kernel honor read-only pages too, so it can't write through a COW page */
 #define KERNEL_ADDR 0x400000 
 #define VIDEO_MEMORY_START 0xB8000
 #define VIRTUAL_VIDEO_START  (VIDEO_MEMORY_START >> 12)
 #define FOURKB   4096
+#define TLB_RANGE_MAX 32   /* longer runs are cheaper to drop with a full flush */
 #define VIDEO_PTE 0
+#define SCRATCH_PTE 1023 /* kernel-only page at the top of the low 4 MB, a window onto frames that aren't mapped */
+#define SCRATCH_ADDR (SCRATCH_PTE << 12)
 #define USR_VIDEO_PDE 33 /* User video mapped to 132 MB, 132 / 4MB = 33 */
+#define USER_PDE 32      /* User programs mapped to 128 MB, 128 / 4MB = 32 */
+#define USER_STACK_SIZE 0x100000 /* top of the user region kept for the stack, the heap stops below it */
 
 extern void init_paging();
+int32_t init_user_space(uint32_t pid_);
+void set_user_image(uint32_t pid_, uint32_t inode_idx, uint32_t length, uint32_t end);
+int32_t user_sbrk(uint32_t pid_, int32_t increment);
+uint32_t user_resident(uint32_t pid_);
+uint32_t user_swapped(uint32_t pid_);
+uint32_t user_pages_live(uint32_t pid_);
+uint32_t user_heap(uint32_t pid_);
+uint32_t user_image_busy(uint32_t inode);
+void free_user_space(uint32_t pid_);
+int32_t clone_user_space(uint32_t parent, uint32_t child);
+void map_user_video(uint32_t pid_, uint32_t tid);
+void map_terminal_video(uint32_t tid, uint32_t paddr);
+uint32_t * user_page_dir(uint32_t pid_);
+void load_page_dir(uint32_t * dir);
+void tlb_invalidate(uint32_t vaddr);
+void tlb_invalidate_range(uint32_t vaddr, uint32_t pages);
+void tlb_stats(uint32_t * full, uint32_t * targeted, uint32_t * switches);
+void zero_frame(uint32_t paddr);
+void share_page_table(uint32_t * from, uint32_t * to, uint32_t vaddr, uint32_t running);
+int32_t copy_on_write(uint32_t * pte, uint32_t vaddr);
+void map_user_page(uint32_t pid_, uint32_t vaddr, uint32_t paddr, uint32_t flags);
+uint32_t user_page_table(uint32_t pid_);
+int32_t swap_in_entry(uint32_t * pte, uint32_t vaddr);
+uint32_t swap_out_page();
+int32_t handle_page_fault(uint32_t vaddr, uint32_t error);
 uint32_t Page_Directory[PDE_SIZE] __attribute__((aligned(4 * PDE_SIZE)));
 uint32_t Page_Table[PTE_SIZE] __attribute__((aligned(4 * PTE_SIZE)));
 
@@ -4,6 +4,7 @@
 #include "x86_desc.h"
 #include "page.h"
 #include "devices/keyboard.h"
+#include "frame.h"
 
 /* context_switch()
  * Description: Called by the pit_handler. Performs a context switch to the next scheduled program
@@ -11,7 +12,7 @@
  * Outputs: none
  * Returns: none
  * Side Effects: Stack frame (esp/ebp) is updated, current_process is current_process->next, tss is updated with next_process->esp0 and KERNEL_DS
- *               virtual memory is remapped, calls start_process which updates other global vars.
+ *               CR3 is loaded with the next process's page directory, calls start_process which updates other global vars.
  */
 void context_switch(process_t * next_process) {
     /* store ebp and esp */
@@ -25,8 +26,8 @@ void context_switch(process_t * next_process) {
         execute((const uint8_t *) "shell");
     }
     else {
-        /* remap next program virtual memory */
-        vmap(_128MB, next_process->pid);
+        /* switch to the next program's address space, the kernel's GLOBAL pages stay in the TLB */
+        load_page_dir(user_page_dir(next_process->pid));
 
         /* set ss0 to be KERNEL_DS, and esp0 to point to the new process's kernel stack */
         tss.ss0 = KERNEL_DS;
@@ -35,6 +36,17 @@ void context_switch(process_t * next_process) {
         /* start up the process */
         start_process(next_process);
 
+        /* a forked process has never been switched away from, so it has no context here yet:
+         * its stack holds the parent's registers from fork and it returns 0 to user space */
+        if(next_process->ebp == 0) {
+            asm volatile(
+                "movl %0, %%esp;"
+                "jmp fork_return;"
+                :
+                : "r"(next_process->esp)
+            );
+        }
+
         /* update stack frame to switch to next scheduled process */
         asm volatile(
             "movl %0, %%esp;"
@@ -58,7 +70,7 @@ int add_process(process_t* p) {
         return -1;
     } 
     /* add the process to global struct */
-    memcpy(&(processes[p->pid]), p, sizeof(process_t));
+    processes[p->pid] = p;
     cli();
     process_t *prev = current_process; 
     process_t *temp = current_process->next;
@@ -66,8 +78,8 @@ int add_process(process_t* p) {
     while(temp != p->parent) {
         /* Handles case where if there's no parent in the list, it just adds it to the linked list */
          if(temp == current_process) {
-             prev->next = &(processes[p->pid]);
-            (&(processes[p->pid]))->next = temp;
+             prev->next = p;
+            p->next = temp;
             return 0;
         }
         prev = prev->next;
@@ -75,12 +87,58 @@ int add_process(process_t* p) {
     }
     /* re-adjust pointers in linked list */
     process_t * temp_next = temp->next;
-    prev->next = &(processes[p->pid]);
-    (&(processes[p->pid]))->next = temp_next;
+    prev->next = p;
+    p->next = temp_next;
     sti();
 	return 0;
 }
 
+/* insert_process()
+ * Description: Adds a forked process to the scheduler linked list and global processes array.
+ *              Its parent keeps running, so unlike add_process nothing is replaced: it goes
+ *              right after the current process.
+ * Inputs: process_t *p - pointer to the forked process
+ * Outputs: none
+ * Returns: 0 if added successfully, -1 if failed
+ * Side Effects: none
+ */
+int insert_process(process_t* p) {
+    if (p == NULL) {
+        return -1;
+    }
+    processes[p->pid] = p;
+    p->next = current_process->next;
+    current_process->next = p;
+    return 0;
+}
+
+/* drop_process()
+ * Description: Takes a forked process out of the scheduler linked list. Nothing waits for it,
+ *              so unlike remove_process no parent takes its place.
+ * Inputs: process_t *p - pointer to the forked process
+ * Outputs: none
+ * Returns: the process that followed it, to run next
+ * Side Effects: If p was its terminal's active process, another process in the same terminal
+ *               becomes active
+ */
+process_t * drop_process(process_t * p) {
+    process_t *prev = p;
+    process_t *temp;
+
+    if (p == NULL) {
+        return NULL;
+    }
+    while (prev->next != p) {
+        prev = prev->next;
+    }
+    prev->next = p->next;
+    if (p->terminal->active == p) {
+        for (temp = p->next; temp->terminal != p->terminal && temp != prev; temp = temp->next);
+        p->terminal->active = temp;
+    }
+    return p->next;
+}
+
 /* remove_process()
  * Description: Removes a process from scheduler linked list and global processes array. Done by replacing it with its parent process
  * Inputs: process_t *p - pointer to a process struct to be removed from linked list and global processes array
@@ -100,12 +158,12 @@ int remove_process(process_t * p) {
         temp = temp->next; 
     }
     /* Delete the process from the linked list (replace it with its parent) */
-    prev->next = &(processes[p->parent->pid]);
-    (&(processes[p->parent->pid]))->next = temp->next;
+    prev->next = p->parent;
+    p->parent->next = temp->next;
     /* Update the active process inside the terminal struct */
-    p->terminal->active = &(processes[p->parent->pid]);
+    p->terminal->active = p->parent;
     /* update the current process to be the parent of the deleted process */
-    current_process = &(processes[p->parent->pid]);
+    current_process = p->parent;
     return 0; 
 }
 
@@ -114,7 +172,7 @@ int remove_process(process_t * p) {
  * Inputs: process_t *p - pointer to a process struct to start
  * Outputs: none
  * Returns: 0 if process started successfully, -1 if failed
- * Side Effects: current_process is updated, TLB is refreshed, paging is updated, and global vars (video_mem, current_process, and pid are updated)
+ * Side Effects: global vars (video_mem, current_process, and pid are updated)
  */
 int start_process(process_t* p) {
     if (p == NULL) {
@@ -122,20 +180,22 @@ int start_process(process_t* p) {
     }
     /* changes global vars based on scheduled process */
 	video_mem = p->terminal->vmem;
-	current_process = &(processes[p->pid]);
+	current_process = p;
 	pid = p->pid;
     p->terminal->active = current_process;
-
-    /* update the paging for the current process */
-    Page_Directory[USR_VIDEO_PDE] = (uint32_t)Page_Table | PRESENT | R_W | User_SUP;
-    /* If the current process is the displayed terminals, map to physical video mem */
-    if(current_process && current_process->terminal == &(terminals[curr_tid])) {
-        Page_Table[VIDEO_PTE] = (uint32_t) VIDEO_MEMORY_START | PRESENT | R_W | User_SUP;
-    }
-    else {
-        /* otherwise, map to the background buffer of the current process's video mem */
-        Page_Table[VIDEO_PTE] = (uint32_t) video_mem | PRESENT | R_W | User_SUP;
-    }
-    flush_TLB();
 	return 0;
 }
+
+/* idle()
+ * Description: Called by a process spinning until an interrupt sets a flag
+ *              (terminal and rtc reads). Nothing it runs is useful until
+ *              then, so the time goes to zeroing a frame for the zero pool
+ *              instead of the page fault or shm_create that needs it later.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Takes a free frame into the zero pool while it isn't full
+ */
+void idle() {
+    refill_zero_pool(IDLE_ZERO_FRAMES);
+}
@@ -5,24 +5,31 @@
 #include "types.h"
 #include "interrupts/syscalls.h"
 
+#define IDLE_ZERO_FRAMES 1 /* frames idle zeroes per call, keeps the wait for the interrupt short */
+
+/* The fields context_switch and start_process touch come first, so the
+ * whole entry (32 bytes) shares one cache line */
 typedef struct process_t {
-	struct terminal_t * terminal; /* Every process is tied to a terminal, allows for lib.c/keyboard.c/terminal.c to work properly */
-	uint8_t pid;				  
-	PCB * pcb; 
+	struct process_t *next; 	  /* scheduler is round-robin (circular) linked list, so we need a next pointer for the next process in queue */
 	uint32_t esp; 				  /* Need for context switch */
 	uint32_t ebp; 				  /* Need for context switch */
-	struct process_t *next; 	  /* scheduler is round-robin (circular) linked list, so we need a next pointer for the next process in queue */
-	struct process_t *parent;     /* Once a process finishes, it needs to return to its parent, so we store the parent as well */
 	uint32_t esp0; 				  /* need for context switch (updates the tss) */
+	struct terminal_t * terminal; /* Every process is tied to a terminal, allows for lib.c/keyboard.c/terminal.c to work properly */
+	uint32_t pid;				  
+	PCB * pcb; 
+	struct process_t *parent;     /* Once a process finishes, it needs to return to its parent, so we store the parent as well (NULL when forked, nothing waits for it) */
 } process_t;
 
-process_t * current_process;        /* Global Current Process (head of linked list) */
-process_t processes[MAX_PROCESSES]; /* Stores the process structs (data container - no functionality)*/
+process_t * current_process;          /* Global Current Process (head of linked list) */
+process_t * processes[MAX_PROCESSES]; /* Running processes by pid, allocated from an object cache by execute */
 
 /* Scheduling Functions */
 int add_process(process_t* p);
 int remove_process(process_t *p);
+int insert_process(process_t* p);
+process_t * drop_process(process_t * p);
 int start_process(process_t* p);
 void context_switch(process_t * next_process); 
+void idle();
 
 #endif
@@ -0,0 +1,284 @@
+#include "shm.h"
+#include "page.h"
+#include "frame.h"
+#include "malloc.h"
+#include "lib.h"
+#include "interrupts/syscalls.h"
+
+/* Segments are attached in the 4 MB at 136 MB through a page table of the
+ * process's own, made the first time it attaches one. A segment's pages
+ * are mapped read/write into every process that attaches it and are never
+ * copy-on-write, so whatever one process stores the others see without
+ * the kernel copying anything. */
+typedef struct shm_space_t {
+    uint32_t * table;               /* page table at 136 MB, NULL until the first attach */
+    uint32_t attached;              /* one bit per segment the process has mapped        */
+    uint16_t base[SHM_SEGMENTS];    /* first page table entry of every mapped segment    */
+} shm_space_t;
+
+static shm_segment_t segments[SHM_SEGMENTS];
+static shm_space_t shm_space[MAX_PROCESSES];
+
+/* put_segment()
+ * Description: Drops one reference to a segment's frames, freeing the
+ *              segment when nothing maps it any more.
+ * Inputs: id - segment to drop
+ * Outputs: none
+ * Returns: none
+ * Side Effects: The slot can be reused for a new key once the segment is freed
+ */
+static void put_segment(int32_t id) {
+    shm_segment_t * seg = &segments[id];
+    uint32_t i;
+
+    if(seg->attached > 0) {
+        seg->attached--;
+    }
+    if(seg->attached > 0) {
+        return;
+    }
+    for(i = 0; i < seg->pages; i++) {
+        free_frame(seg->frames[i]);
+    }
+    kfree(seg->frames);
+    memset(seg, 0, sizeof(shm_segment_t));
+}
+
+/* shm_get()
+ * Description: Finds the segment with a key, creating it with zeroed
+ *              frames if there isn't one.
+ * Inputs: key - name of the segment
+ *         size - bytes the caller needs, rounded up to whole pages
+ * Outputs: none
+ * Returns: the segment's id, -1 if size is 0 or over SHM_MAX_PAGES pages,
+ *          an existing segment is smaller, or memory or slots ran out
+ * Side Effects: A new segment lives until the last process that attached
+ *               it detaches
+ */
+int32_t shm_get(uint32_t key, uint32_t size) {
+    uint32_t pages = (size + FOURKB - 1) / FOURKB;
+    uint32_t i, frame;
+    int32_t id, free_id = -1;
+    shm_segment_t * seg;
+
+    if(size == 0 || pages > SHM_MAX_PAGES) {
+        return -1;
+    }
+    for(id = 0; id < SHM_SEGMENTS; id++) {
+        if(segments[id].pages == 0) {
+            if(free_id == -1) {
+                free_id = id;
+            }
+        } else if(segments[id].key == key) {
+            return (segments[id].pages >= pages) ? id : -1;
+        }
+    }
+    if(free_id == -1) {
+        return -1;
+    }
+
+    seg = &segments[free_id];
+    seg->frames = kmalloc(pages * sizeof(uint32_t));
+    if(seg->frames == NULL) {
+        return -1;
+    }
+    seg->key = key;
+    for(seg->pages = 0; seg->pages < pages; seg->pages++) {
+        frame = alloc_zeroed_frame();
+        if(frame == 0) {
+            break;
+        }
+        seg->frames[seg->pages] = frame;
+    }
+    if(seg->pages < pages) {
+        for(i = 0; i < seg->pages; i++) {
+            free_frame(seg->frames[i]);
+        }
+        kfree(seg->frames);
+        memset(seg, 0, sizeof(shm_segment_t));
+        return -1;
+    }
+    return free_id;
+}
+
+/* shm_map()
+ * Description: Maps a segment into a process at the first run of free
+ *              pages at 136 MB that is long enough.
+ * Inputs: pid_ - process attaching the segment
+ *         id - segment from shm_get
+ * Outputs: none
+ * Returns: user address of the segment (the same one again if it is
+ *          already attached), -1 if the id is bad, the process has no
+ *          address space or no run of pages is free
+ * Side Effects: Makes the process's shared memory page table on first use
+ */
+int32_t shm_map(uint32_t pid_, int32_t id) {
+    shm_space_t * space = &shm_space[pid_];
+    shm_segment_t * seg = &segments[id];
+    uint32_t * dir = user_page_dir(pid_);
+    uint32_t i, run, base;
+
+    if(id < 0 || id >= SHM_SEGMENTS || seg->pages == 0 || dir == Page_Directory) {
+        return -1;
+    }
+    if(space->attached & (1 << id)) {
+        return SHM_BASE + space->base[id] * FOURKB;
+    }
+    if(space->table == NULL) {
+        space->table = kmalloc(FOURKB);
+        if(space->table == NULL) {
+            return -1;
+        }
+        for(i = 0; i < PTE_SIZE; i++) {
+            space->table[i] = R_W | User_SUP;
+        }
+        dir[SHM_PDE] = (uint32_t) space->table | PRESENT | R_W | User_SUP;
+    }
+
+    for(base = 0, run = 0; base + run < PTE_SIZE && run < seg->pages; ) {
+        if(space->table[base + run] & PRESENT) {
+            base += run + 1;
+            run = 0;
+        } else {
+            run++;
+        }
+    }
+    if(run < seg->pages) {
+        return -1;
+    }
+    /* the entries weren't present, so nothing of them is in the TLB */
+    for(i = 0; i < seg->pages; i++) {
+        space->table[base + i] = seg->frames[i] | PRESENT | R_W | User_SUP;
+        share_frame(seg->frames[i]);
+    }
+    space->attached |= 1 << id;
+    space->base[id] = base;
+    seg->attached++;
+    return SHM_BASE + base * FOURKB;
+}
+
+/* detach()
+ * Description: Unmaps one segment from a process.
+ * Inputs: pid_ - process the segment is attached to
+ *         id - segment to unmap
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Drops the pages from the TLB if pid_ is running
+ */
+static void detach(uint32_t pid_, int32_t id) {
+    shm_space_t * space = &shm_space[pid_];
+    uint32_t i, pages = segments[id].pages;
+
+    for(i = 0; i < pages; i++) {
+        free_frame(space->table[space->base[id] + i] & PAGE_MASK);
+        space->table[space->base[id] + i] = R_W | User_SUP;
+    }
+    if(pid_ == pid) {
+        tlb_invalidate_range(SHM_BASE + space->base[id] * FOURKB, pages);
+    }
+    space->attached &= ~(1 << id);
+    put_segment(id);
+}
+
+/* shm_unmap()
+ * Description: Detaches the segment a process attached at an address.
+ * Inputs: pid_ - process detaching it
+ *         addr - address shm_map returned
+ * Outputs: none
+ * Returns: 0 on success, -1 if no segment is attached there
+ * Side Effects: Frees the segment if pid_ was the last process using it
+ */
+int32_t shm_unmap(uint32_t pid_, uint32_t addr) {
+    shm_space_t * space = &shm_space[pid_];
+    int32_t id;
+
+    for(id = 0; id < SHM_SEGMENTS; id++) {
+        if((space->attached & (1 << id)) && SHM_BASE + space->base[id] * FOURKB == addr) {
+            detach(pid_, id);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* shm_clone()
+ * Description: Attaches every segment of one process to another at the
+ *              same addresses, for fork. The pages stay shared, they are
+ *              not copied on write.
+ * Inputs: parent - process whose segments are attached
+ *         child - process that gets them, with a fresh address space
+ * Outputs: none
+ * Returns: 0 on success, -1 if the kernel heap is out of pages
+ * Side Effects: none
+ */
+int32_t shm_clone(uint32_t parent, uint32_t child) {
+    shm_space_t * from = &shm_space[parent];
+    shm_space_t * to = &shm_space[child];
+    int32_t id;
+    uint32_t i;
+
+    if(from->table == NULL) {
+        return 0;
+    }
+    to->table = kmalloc(FOURKB);
+    if(to->table == NULL) {
+        return -1;
+    }
+    memcpy(to->table, from->table, FOURKB);
+    memcpy(to->base, from->base, sizeof(to->base));
+    to->attached = from->attached;
+    user_page_dir(child)[SHM_PDE] = (uint32_t) to->table | PRESENT | R_W | User_SUP;
+    for(i = 0; i < PTE_SIZE; i++) {
+        if(to->table[i] & PRESENT) {
+            share_frame(to->table[i] & PAGE_MASK);
+        }
+    }
+    for(id = 0; id < SHM_SEGMENTS; id++) {
+        if(to->attached & (1 << id)) {
+            segments[id].attached++;
+        }
+    }
+    return 0;
+}
+
+/* shm_release()
+ * Description: Detaches every segment of a process that is going away
+ *              and frees its shared memory page table.
+ * Inputs: pid_ - process being torn down
+ * Outputs: none
+ * Returns: none
+ * Side Effects: pid_'s directory must not be loaded in CR3
+ */
+void shm_release(uint32_t pid_) {
+    shm_space_t * space = &shm_space[pid_];
+    int32_t id;
+
+    for(id = 0; id < SHM_SEGMENTS; id++) {
+        if(space->attached & (1 << id)) {
+            detach(pid_, id);
+        }
+    }
+    kfree(space->table);
+    memset(space, 0, sizeof(shm_space_t));
+}
+
+/* shm_stats()
+ * Description: Reports how much memory shared memory segments hold.
+ * Inputs: count - filled with the number of live segments
+ *         pages - filled with the number of pages they hold
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void shm_stats(uint32_t * count, uint32_t * pages) {
+    int32_t id;
+
+    *count = 0;
+    *pages = 0;
+    for(id = 0; id < SHM_SEGMENTS; id++) {
+        if(segments[id].pages != 0) {
+            (*count)++;
+            *pages += segments[id].pages;
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef SHM_H
+#define SHM_H
+
+#include "types.h"
+
+#define SHM_PDE         34                  /* segments are attached from 136 MB, 136 / 4MB = 34 */
+#define SHM_SEGMENTS    16
+#define SHM_MAX_PAGES   256                 /* 1 MB per segment                                  */
+#define SHM_BASE        (SHM_PDE << 22)
+
+/* A shared memory segment: frames that stay put while processes attach
+ * and detach them. The segment holds one reference to every frame and
+ * every attached process another, so the frames go back to the frame
+ * allocator with whoever drops the last one. */
+typedef struct shm_segment_t {
+    uint32_t key;       /* name processes find the segment by           */
+    uint32_t pages;     /* 0 while the slot is unused                   */
+    uint32_t attached;  /* processes that have the segment mapped       */
+    uint32_t * frames;  /* physical address of every page, kmalloc'd    */
+} shm_segment_t;
+
+int32_t shm_get(uint32_t key, uint32_t size);
+int32_t shm_map(uint32_t pid_, int32_t id);
+int32_t shm_unmap(uint32_t pid_, uint32_t addr);
+int32_t shm_clone(uint32_t parent, uint32_t child);
+void shm_release(uint32_t pid_);
+void shm_stats(uint32_t * count, uint32_t * pages);
+
+#endif
@@ -0,0 +1,156 @@
+#include "slab.h"
+#include "malloc.h"
+#include "lib.h"
+
+static kmem_cache_t *caches; /* every initialized cache, newest first */
+
+/* pack_size()
+ * Description: Rounds an object size so no object straddles more cache
+ *              lines than it has to: small objects are rounded to a power
+ *              of two that divides the line, bigger ones to whole lines.
+ *              Slabs are page aligned, so every object starts on such a
+ *              boundary.
+ * Inputs: size - size of the object type
+ * Outputs: none
+ * Returns: the size objects take up in a slab
+ * Side Effects: none
+ */
+static uint32_t pack_size(uint32_t size) {
+    uint32_t packed = sizeof(void *);
+
+    if (size >= CACHE_LINE) {
+        return (size + CACHE_LINE - 1) & ~(CACHE_LINE - 1);
+    }
+    while (packed < size) {
+        packed <<= 1;
+    }
+    return packed;
+}
+
+/* kmem_cache_init()
+ * Description: Sets up an empty object cache. Slabs are added the first
+ *              time an object is allocated.
+ * Inputs: cache - cache to set up
+ *         name - shown by kmem_stats_dump
+ *         size - size of one object, at most SLAB_SIZE
+ *         ctor - run on every object before kmem_cache_alloc returns it, or NULL
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Adds the cache to the list kmem_stats_dump prints
+ */
+void kmem_cache_init(kmem_cache_t *cache, const int8_t *name, uint32_t size, void (*ctor)(void *)) {
+    memset(cache, 0, sizeof(kmem_cache_t));
+    strncpy(cache->name, name, SLAB_NAME_LEN - 1);
+    cache->size = pack_size(size);
+    cache->ctor = ctor;
+    cache->next = caches;
+    caches = cache;
+}
+
+/* cache_grow()
+ * Description: Carves a fresh kmalloc page into objects and puts them on
+ *              the cache's free list, lowest address first.
+ * Inputs: cache - cache to grow
+ * Outputs: none
+ * Returns: 0 on success, -1 if the kernel heap is out of pages
+ * Side Effects: Called with interrupts off
+ */
+static int32_t cache_grow(kmem_cache_t *cache) {
+    uint8_t *slab = kmalloc(SLAB_SIZE);
+    int32_t i, count = SLAB_SIZE / cache->size;
+
+    if (slab == NULL) {
+        return -1;
+    }
+    for (i = count - 1; i >= 0; i--) {
+        *(void **) (slab + i * cache->size) = cache->free;
+        cache->free = slab + i * cache->size;
+    }
+    cache->slabs++;
+    cache->total += count;
+    return 0;
+}
+
+/* kmem_cache_alloc()
+ * Description: Pops an object off the cache's free list, adding a slab
+ *              if the list is empty.
+ * Inputs: cache - cache to allocate from
+ * Outputs: none
+ * Returns: the constructed object, NULL if no memory is left
+ * Side Effects: Disables interrupts while the free list changes
+ */
+void *kmem_cache_alloc(kmem_cache_t *cache) {
+    void *obj;
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (cache->free == NULL && cache_grow(cache) == -1) {
+        cache->failures++;
+        restore_flags(flags);
+        return NULL;
+    }
+    obj = cache->free;
+    cache->free = *(void **) obj;
+    cache->active++;
+    cache->allocs++;
+    restore_flags(flags);
+
+    if (cache->ctor != NULL) {
+        cache->ctor(obj);
+    }
+    return obj;
+}
+
+/* kmem_cache_free()
+ * Description: Pushes an object back on its cache's free list.
+ * Inputs: cache - cache the object came from
+ *         obj - object to free, or NULL
+ * Outputs: none
+ * Returns: none
+ * Side Effects: Overwrites the object's first word. Slabs stay with the
+ *               cache once they are added.
+ */
+void kmem_cache_free(kmem_cache_t *cache, void *obj) {
+    uint32_t flags;
+
+    if (obj == NULL) {
+        return;
+    }
+    cli_and_save(flags);
+    *(void **) obj = cache->free;
+    cache->free = obj;
+    cache->active--;
+    cache->frees++;
+    restore_flags(flags);
+}
+
+/* kmem_cache_list()
+ * Description: Gives every initialized cache, for reporting its counters.
+ * Inputs: none
+ * Outputs: none
+ * Returns: the newest cache, the rest follow through next
+ * Side Effects: none
+ */
+kmem_cache_t *kmem_cache_list() {
+    return caches;
+}
+
+/* kmem_stats_dump()
+ * Description: Prints kernel heap use and the counters of every object cache.
+ * Inputs: none
+ * Outputs: one line for the heap and one line per cache
+ * Returns: none
+ * Side Effects: none
+ */
+void kmem_stats_dump() {
+    kheap_stats_t heap;
+    kmem_cache_t *cache;
+
+    kheap_stats(&heap);
+    printf("kheap: %u/%u KB in use, peak %u KB, largest free %u KB in %u free blocks\n",
+           heap.in_use >> 10, heap.heap_size >> 10, heap.peak >> 10, heap.largest_free >> 10, heap.free_blocks);
+    for (cache = caches; cache != NULL; cache = cache->next) {
+        printf("%s: %u B, %u/%u in use, %u slabs, %u allocs, %u frees, %u failed\n", cache->name, cache->size,
+               cache->active, cache->total, cache->slabs, cache->allocs, cache->frees, cache->failures);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "types.h"
+
+#define SLAB_SIZE       4096    /* every slab is one page from kmalloc   */
+#define CACHE_LINE      64
+#define SLAB_NAME_LEN   12
+
+/* Object caches hand out fixed size kernel objects from slabs carved out
+ * of kmalloc pages, so allocating or freeing one is a list pop or push. */
+typedef struct kmem_cache_t {
+    void *free;                 /* free objects, linked through their first word */
+    uint32_t size;              /* object size after cache line packing          */
+    void (*ctor)(void *);       /* run on every object kmem_cache_alloc returns  */
+    uint32_t active;            /* objects handed out right now                  */
+    uint32_t total;             /* objects in all slabs                          */
+    uint32_t slabs;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;          /* allocs that needed a slab and got no page     */
+    int8_t name[SLAB_NAME_LEN];
+    struct kmem_cache_t *next;  /* every cache, for kmem_stats_dump              */
+} kmem_cache_t;
+
+void kmem_cache_init(kmem_cache_t *cache, const int8_t *name, uint32_t size, void (*ctor)(void *));
+void *kmem_cache_alloc(kmem_cache_t *cache);
+void kmem_cache_free(kmem_cache_t *cache, void *obj);
+kmem_cache_t *kmem_cache_list();
+void kmem_stats_dump();
+
+#endif
@@ -0,0 +1,158 @@
+#include "swap.h"
+#include "devices/ata.h"
+#include "page.h"
+#include "lib.h"
+
+/* Swap space on the ATA disk: one slot per page, SWAP_SLOT_SECTORS sectors
+ * each. A slot is used by every page table entry that points at it: fork
+ * copies entries of swapped out pages like it does present ones, and each
+ * side reads its own copy back in. */
+static uint16_t slot_refs[SWAP_MAX_SLOTS];
+static uint32_t next_slot;  /* where swap_alloc starts looking */
+static swap_stats_t counters;
+
+/* init_swap()
+ * Description: Sizes the swap space from the disk init_ata found.
+ * Inputs: none
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void init_swap() {
+    counters.slots = ata_sectors() / SWAP_SLOT_SECTORS;
+    if(counters.slots > SWAP_MAX_SLOTS) {
+        counters.slots = SWAP_MAX_SLOTS;
+    }
+}
+
+/* swap_alloc()
+ * Description: Takes a free slot.
+ * Inputs: none
+ * Outputs: none
+ * Returns: the slot, -1 if swap is full or there is no swap disk
+ * Side Effects: None
+ */
+int32_t swap_alloc() {
+    uint32_t i, slot;
+
+    for(i = 0; i < counters.slots; i++) {
+        slot = (next_slot + i) % counters.slots;
+        if(slot_refs[slot] == 0) {
+            slot_refs[slot] = 1;
+            counters.used++;
+            next_slot = slot + 1;
+            return slot;
+        }
+    }
+    return -1;
+}
+
+/* swap_dup()
+ * Description: Counts one more page table entry pointing at a slot.
+ * Inputs: slot - slot from swap_alloc
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void swap_dup(uint32_t slot) {
+    if(slot < counters.slots) {
+        slot_refs[slot]++;
+    }
+}
+
+/* swap_free()
+ * Description: Drops one page table entry pointing at a slot, freeing the
+ *              slot when it was the last one.
+ * Inputs: slot - slot from swap_alloc
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void swap_free(uint32_t slot) {
+    if(slot < counters.slots && slot_refs[slot] > 0 && --slot_refs[slot] == 0) {
+        counters.used--;
+    }
+}
+
+/* swap_write()
+ * Description: Writes a frame out to a slot, through the scratch window.
+ * Inputs: slot - slot from swap_alloc
+ *         paddr - frame to write
+ * Outputs: none
+ * Returns: 0 on success, -1 on a disk error
+ * Side Effects: Interrupts must be off
+ */
+int32_t swap_write(uint32_t slot, uint32_t paddr) {
+    int32_t ret;
+
+    Page_Table[SCRATCH_PTE] = (paddr & PAGE_MASK) | PRESENT | R_W;
+    tlb_invalidate(SCRATCH_ADDR);
+    ret = ata_write(slot * SWAP_SLOT_SECTORS, SWAP_SLOT_SECTORS, (const void *) SCRATCH_ADDR);
+    Page_Table[SCRATCH_PTE] = R_W;
+    tlb_invalidate(SCRATCH_ADDR);
+    if(ret == 0) {
+        counters.outs++;
+    }
+    return ret;
+}
+
+/* swap_read()
+ * Description: Reads a slot back into a frame, through the scratch window.
+ * Inputs: slot - slot from swap_alloc
+ *         paddr - frame to fill
+ * Outputs: none
+ * Returns: 0 on success, -1 on a disk error
+ * Side Effects: Interrupts must be off
+ */
+int32_t swap_read(uint32_t slot, uint32_t paddr) {
+    int32_t ret;
+
+    Page_Table[SCRATCH_PTE] = (paddr & PAGE_MASK) | PRESENT | R_W;
+    tlb_invalidate(SCRATCH_ADDR);
+    ret = ata_read(slot * SWAP_SLOT_SECTORS, SWAP_SLOT_SECTORS, (void *) SCRATCH_ADDR);
+    Page_Table[SCRATCH_PTE] = R_W;
+    tlb_invalidate(SCRATCH_ADDR);
+    if(ret == 0) {
+        counters.ins++;
+    }
+    return ret;
+}
+
+/* swap_count_in()
+ * Description: Records how long a swap-in fault took.
+ * Inputs: cycles - TSC cycles from the fault to the page being mapped
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void swap_count_in(uint32_t cycles) {
+    counters.in_kcycles += cycles >> SWAP_CYCLE_SHIFT;
+    if(cycles > counters.in_max) {
+        counters.in_max = cycles;
+    }
+}
+
+/* swap_count_out()
+ * Description: Records how long writing out a victim took.
+ * Inputs: cycles - TSC cycles from choosing the victim to freeing its frame
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void swap_count_out(uint32_t cycles) {
+    counters.out_kcycles += cycles >> SWAP_CYCLE_SHIFT;
+    if(cycles > counters.out_max) {
+        counters.out_max = cycles;
+    }
+}
+
+/* swap_stats()
+ * Description: Copies out the swap counters.
+ * Inputs: stats - filled with the counters
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+void swap_stats(swap_stats_t * stats) {
+    *stats = counters;
+}
@@ -0,0 +1,34 @@
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "types.h"
+
+#define SWAP_MAX_SLOTS      16384   /* 64 MB of swap, more disk is ignored        */
+#define SWAP_SLOT_SECTORS   8       /* 4 KB page / 512 byte sectors               */
+#define SWAP_SCAN_PASSES    2       /* clock sweeps before giving up on a victim  */
+#define SWAP_CYCLE_SHIFT    10      /* latency totals are kept in 1024 cycle units */
+
+/* Counters since boot. Latencies are TSC cycles of the page fault that
+ * read a page back in and of the allocation that wrote one out. */
+typedef struct swap_stats_t {
+    uint32_t slots;         /* pages the swap disk holds, 0 without one */
+    uint32_t used;          /* slots holding a page                     */
+    uint32_t ins;           /* pages read back in                       */
+    uint32_t outs;          /* pages written out                        */
+    uint32_t in_kcycles;    /* total swap-in fault time, in 1024 cycles */
+    uint32_t in_max;        /* slowest swap-in fault                    */
+    uint32_t out_kcycles;   /* total eviction time, in 1024 cycles      */
+    uint32_t out_max;       /* slowest eviction                         */
+} swap_stats_t;
+
+void init_swap();
+int32_t swap_alloc();
+void swap_dup(uint32_t slot);
+void swap_free(uint32_t slot);
+int32_t swap_write(uint32_t slot, uint32_t paddr);
+int32_t swap_read(uint32_t slot, uint32_t paddr);
+void swap_count_in(uint32_t cycles);
+void swap_count_out(uint32_t cycles);
+void swap_stats(swap_stats_t * stats);
+
+#endif
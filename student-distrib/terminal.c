@@ -77,19 +77,15 @@ int start_terminal(uint8_t tid) {
     int loc = NUM_COLS * mouse_display_y + mouse_display_x;
     *(uint8_t *)(VIDEO_MEMORY_START + (loc << 1) + 1) = (ATTRIB & 0x0F | 0xC0);
 
-    /* Update the paging and flush the TLB afterwards */
-    Page_Directory[USR_VIDEO_PDE] = (uint32_t)Page_Table | PRESENT | R_W | User_SUP;
-    /* If the current process is the displayed terminals, map to physical video mem */
-    if(current_process && current_process->terminal == &(terminals[curr_tid])) {
-        Page_Table[VIDEO_PTE] = (uint32_t) VIDEO_MEMORY_START | PRESENT | R_W | User_SUP;
-    }
-    else {
-        /* otherwise, map to the background buffer of the current process's video mem */
-        Page_Table[VIDEO_PTE] = (uint32_t) video_mem | PRESENT | R_W | User_SUP;
+    /* Update the paging and drop only the two pages that changed from the TLB */
+    /* vidmap'd programs in the displayed terminal see physical video mem, the others their terminal's buffer */
+    for(i = 0; i < MAX_TERMINALS; i++) {
+        map_terminal_video(i, i == tid ? VIDEO_MEMORY_START : (uint32_t) terminals[i].vmem);
     }
     /* SHIFT 12 to get top 20 MSB */
-    Page_Table[(uint32_t) terminals[tid].vmem>>12] = VIDEO_MEMORY_START | PRESENT | R_W;
-    flush_TLB();
+    Page_Table[(uint32_t) terminals[tid].vmem>>12] = VIDEO_MEMORY_START | PRESENT | R_W | GLOBAL;
+    tlb_invalidate((uint32_t) terminals[tid].vmem);
+    tlb_invalidate(USR_VIDEO_PDE << 22);
 
     /* Update the screen coordinates */
     set_screen_coordinates(terminals[tid].curr_x, terminals[tid].curr_y);
@@ -118,8 +114,9 @@ uint8_t * create_vmem(uint8_t tid) {
     }
     uint32_t vaddr = VIDEO_MEMORY_START + (1 + tid)*_4KB;
     /* SHIFT 12 to get top 20 MSB */
-    Page_Table[vaddr>>12] = vaddr | (PRESENT) | (R_W) | User_SUP;
-    flush_TLB();
+    Page_Table[vaddr>>12] = vaddr | (PRESENT) | (R_W) | User_SUP | GLOBAL;
+    map_terminal_video(tid, vaddr);
+    tlb_invalidate(vaddr);
     return (uint8_t*) vaddr;
 }
 
@@ -138,8 +135,8 @@ void save_terminal_state() {
 
     uint32_t vaddr = (uint32_t) terminals[curr_tid].vmem;
     /* SHIFT 12 to get top 20 MSB */
-    Page_Table[vaddr>>12] = vaddr | (PRESENT) | (R_W);
-    flush_TLB();
+    Page_Table[vaddr>>12] = vaddr | (PRESENT) | (R_W) | GLOBAL;
+    tlb_invalidate(vaddr);
      asm volatile(
         "pushfl;"
         "popl %0;"
@@ -190,7 +187,9 @@ int32_t terminal_read(uint32_t ignore, void * buffer, uint32_t n) {
     buff_idx = terminals[current_process->terminal->tid].buff_idx;
 
     /* wait until the active process's buffer is terminated with a newline */
-    while(tb[buff_idx]!='\n');
+    while(tb[buff_idx]!='\n') {
+        idle();
+    }
 
     int i, j;
     clear_buffer((unsigned char*) buffer, n);
@@ -5,6 +5,17 @@
 #include "filesystem.h"
 #include "devices/rtc.h"
 #include "terminal.h"
+#include "interrupts/syscalls.h"
+#include "devices/PIT.h"
+#include "malloc.h"
+#include "slab.h"
+#include "frame.h"
+#include "page.h"
+#include "shm.h"
+#include "mmap.h"
+#include "memstat.h"
+#include "textcache.h"
+#include "swap.h"
 
 #define PASS 1
 #define FAIL 0
@@ -485,6 +496,932 @@ int test_dir() {
 	return PASS;
 }
 
+/* test_extents()
+ * Description: Prints the extent map of every regular file and checks that
+ *              reading the file through it matches read_data.
+ * Inputs: None
+ * Outputs: name, extent count and runs of each file (0 extents means the
+ *          file is empty or too fragmented and is read through the inode)
+ * Side Effects: None
+ */
+int test_extents() {
+	static uint8_t by_inode[40000], by_extent[40000];
+	extent_map_t map;
+	dentry_t dentry;
+	uint32_t i, j, length;
+	int result = PASS;
+
+	for(i = 0; i < FS_MAX_DENTRIES && read_dentry_by_index(i, &dentry) == 0; i++) {
+		if(dentry.f_type != EXEC_TYPE) {
+			continue;
+		}
+		build_extents(dentry.inode, &map);
+		printf("%s: %d extents", dentry.f_name, map.count);
+		for(j = 0; j < map.count; j++) {
+			printf(" [%d+%d]", map.run[j].start, map.run[j].length);
+		}
+		putc('\n');
+
+		length = (inodes + dentry.inode)->length;
+		if(length > sizeof(by_inode)) {
+			length = sizeof(by_inode);
+		}
+		if(read_data(dentry.inode, 0, by_inode, length) != read_extents(&map, dentry.inode, 0, by_extent, length)) {
+			result = FAIL;
+		}
+		for(j = 0; j < length; j++) {
+			if(by_inode[j] != by_extent[j]) {
+				result = FAIL;
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+/* test_fs_write()
+ * Description: Creates a file, writes it in pieces (append, overwrite and a
+ *              write that spans blocks) and reads it back through both the
+ *              inode and a freshly built extent map.
+ * Inputs: None
+ * Outputs: blocks used before and after, and the new file's extents
+ * Side Effects: Leaves "write_test" in the in-memory filesystem
+ */
+int test_fs_write() {
+	static uint8_t expect[3 * BLOCK_SIZE], back[3 * BLOCK_SIZE];
+	const uint8_t * name = (const uint8_t *) "write_test";
+	extent_map_t map;
+	dentry_t dentry;
+	uint32_t i, before = fs_free_blocks();
+	int result = PASS;
+
+	for(i = 0; i < sizeof(expect); i++) {
+		expect[i] = i * 7;
+	}
+	if(read_dentry_by_name(name, &dentry) != 0) {
+		fs_create(name);
+	}
+	if(read_dentry_by_name(name, &dentry) != 0 || fs_create(name) != -1) {
+		return FAIL;
+	}
+	/* append in two pieces, the second one crossing two block boundaries */
+	if(write_data(dentry.inode, 0, expect, 100) != 100 ||
+	   write_data(dentry.inode, 100, expect + 100, sizeof(expect) - 100) != sizeof(expect) - 100) {
+		result = FAIL;
+	}
+	/* overwrite the middle of the file with the same bytes */
+	if(write_data(dentry.inode, BLOCK_SIZE - 10, expect + BLOCK_SIZE - 10, 20) != 20 ||
+	   write_data(dentry.inode, sizeof(expect) + 1, expect, 1) != -1) {
+		result = FAIL;
+	}
+	if((inodes + dentry.inode)->length != sizeof(expect)) {
+		result = FAIL;
+	}
+	build_extents(dentry.inode, &map);
+	printf("free blocks %d -> %d, %d extents\n", before, fs_free_blocks(), map.count);
+	if(read_extents(&map, dentry.inode, 0, back, sizeof(back)) != sizeof(back)) {
+		result = FAIL;
+	}
+	for(i = 0; i < sizeof(expect); i++) {
+		if(back[i] != expect[i]) {
+			result = FAIL;
+			break;
+		}
+	}
+	return result;
+}
+
+/* test_kmalloc()
+ * Description: Checks kmalloc hands out aligned, non-overlapping blocks,
+ *              rejects sizes it can't serve, ignores bad frees, and that
+ *              freeing everything merges the heap back together.
+ * Inputs: None
+ * Outputs: heap use while the blocks are live
+ * Side Effects: None
+ */
+int test_kmalloc() {
+	uint32_t sizes[5] = {1, 32, 100, _4KB, 3 * _4KB};
+	uint8_t * blocks[5];
+	kheap_stats_t before, during, after;
+	uint32_t i, j;
+	int result = PASS;
+
+	kheap_stats(&before);
+	for(i = 0; i < 5; i++) {
+		blocks[i] = kmalloc(sizes[i]);
+		if(blocks[i] == NULL) {
+			return FAIL;
+		}
+		memset(blocks[i], i, sizes[i]);
+	}
+	/* 3 x 4 KB rounds up to 16 KB, and every block is aligned to its size */
+	if(((uint32_t) blocks[3] & (_4KB - 1)) || ((uint32_t) blocks[4] & (4 * _4KB - 1))) {
+		result = FAIL;
+	}
+	for(i = 0; i < 5; i++) {
+		for(j = 0; j < sizes[i]; j++) {
+			if(blocks[i][j] != i) {
+				result = FAIL;
+			}
+		}
+	}
+	if(kmalloc(0) != NULL || kmalloc(KHEAP_SIZE + 1) != NULL) {
+		result = FAIL;
+	}
+	kheap_stats(&during);
+	printf("in use %u -> %u bytes, %u free blocks\n", before.in_use, during.in_use, during.free_blocks);
+	if(during.in_use - before.in_use != 32 + 32 + 128 + _4KB + 4 * _4KB) {
+		result = FAIL;
+	}
+
+	for(i = 0; i < 5; i++) {
+		kfree(blocks[i]);
+	}
+	/* a double free, a pointer into a block and a non-heap pointer do nothing */
+	kfree(blocks[0]);
+	kfree(blocks[4] + 32);
+	kfree(&result);
+	kheap_stats(&after);
+	if(after.in_use != before.in_use || after.largest_free != before.largest_free ||
+	   after.free_blocks != before.free_blocks) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* slab_test_ctor()
+ * Description: Constructor for the test cache, marks the object.
+ * Inputs: obj - object being handed out
+ * Outputs: none
+ * Returns: none
+ * Side Effects: None
+ */
+static void slab_test_ctor(void * obj) {
+	memset(obj, 0x5A, 24);
+}
+
+/* test_slab()
+ * Description: Checks an object cache packs objects to cache line friendly
+ *              sizes, runs the constructor on every allocation, reuses the
+ *              last freed object first and keeps its counters straight.
+ * Inputs: None
+ * Outputs: every cache's counters
+ * Side Effects: Leaves the test cache (and its slab) in the cache list
+ */
+int test_slab() {
+	static kmem_cache_t cache;
+	uint8_t * objs[SLAB_SIZE / 32 + 1];
+	uint32_t i, j;
+	int result = PASS;
+
+	kmem_cache_init(&cache, "test", 24, slab_test_ctor);
+	if(cache.size != 32) {
+		result = FAIL;
+	}
+	/* one more object than a slab holds, so a second slab gets added */
+	for(i = 0; i < SLAB_SIZE / 32 + 1; i++) {
+		objs[i] = kmem_cache_alloc(&cache);
+		if(objs[i] == NULL || ((uint32_t) objs[i] & 31)) {
+			return FAIL;
+		}
+		for(j = 0; j < 24; j++) {
+			if(objs[i][j] != 0x5A) {
+				result = FAIL;
+			}
+		}
+		objs[i][0] = 0;
+	}
+	if(cache.slabs != 2 || cache.active != SLAB_SIZE / 32 + 1) {
+		result = FAIL;
+	}
+	kmem_cache_free(&cache, objs[3]);
+	if(kmem_cache_alloc(&cache) != objs[3] || objs[3][0] != 0x5A) {
+		result = FAIL;
+	}
+	for(i = 0; i < SLAB_SIZE / 32 + 1; i++) {
+		kmem_cache_free(&cache, objs[i]);
+	}
+	if(cache.active != 0 || cache.allocs != cache.frees) {
+		result = FAIL;
+	}
+	kmem_stats_dump();
+	return result;
+}
+
+/* test_frames()
+ * Description: Checks the frame allocator hands out aligned regions above
+ *              the reserved low memory, packs single frames into one
+ *              region, and gets every frame back when they are freed.
+ * Inputs: None
+ * Outputs: installed and free memory
+ * Side Effects: None
+ */
+int test_frames() {
+	uint32_t total, free, regions, total2, free2, regions2;
+	uint32_t region, frame, frame2;
+	int result = PASS;
+
+	frame_stats(&total, &free, &regions);
+	printf("%u MB of RAM, %u MB free, %u free 4 MB regions\n", total >> 8, free >> 8, regions);
+	region = alloc_region();
+	if(regions > 0 && (region < FRAME_RESERVED || (region & (REGION_SIZE - 1)))) {
+		result = FAIL;
+	}
+	/* two single frames come from the same region, which isn't a free region any more */
+	frame = alloc_frame();
+	frame2 = alloc_frame();
+	if(frame < FRAME_RESERVED || (frame & (FRAME_SIZE - 1)) || frame == frame2 ||
+	   (frame & ~(REGION_SIZE - 1)) != (frame2 & ~(REGION_SIZE - 1))) {
+		result = FAIL;
+	}
+	if(frame >= KHEAP_START && frame < KHEAP_START + KHEAP_SIZE) {
+		result = FAIL;
+	}
+	frame_stats(&total2, &free2, &regions2);
+	if(free2 != free - FRAMES_PER_REGION - 2) {
+		result = FAIL;
+	}
+	free_frame(frame);
+	free_frame(frame2);
+	free_region(region);
+	frame_stats(&total2, &free2, &regions2);
+	if(free2 != free || regions2 != regions) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* test_tlb()
+ * Description: Checks invlpg drops a stale translation: a user page is
+ *              read (so it is in the TLB), remapped to another frame and
+ *              invalidated, and must then read the other frame. Also
+ *              checks the flush counters. Must run before any process
+ *              exists: it borrows pid 0.
+ * Inputs: None
+ * Outputs: full and targeted flush counts
+ * Side Effects: Leaves the global page directory loaded
+ */
+int test_tlb() {
+	uint32_t frame[2];
+	uint32_t full, targeted, switches, full2, targeted2, switches2;
+	volatile uint32_t * page = (volatile uint32_t *) _128MB;
+	int result = PASS;
+
+	frame[0] = alloc_frame();
+	frame[1] = alloc_frame();
+	if(frame[0] == 0 || frame[1] == 0 || init_user_space(0) == -1) {
+		free_frame(frame[0]);
+		free_frame(frame[1]);
+		return FAIL;
+	}
+	map_user_page(0, _128MB, frame[0], PRESENT | R_W | User_SUP);
+	map_user_page(0, _128MB + FOURKB, frame[1], PRESENT | R_W | User_SUP);
+	load_page_dir(user_page_dir(0));
+	page[0] = 0xAA;
+	page[FOURKB / sizeof(uint32_t)] = 0xBB;
+
+	tlb_stats(&full, &targeted, &switches);
+	if(page[0] != 0xAA) {
+		result = FAIL;
+	}
+	map_user_page(0, _128MB, frame[1], PRESENT | R_W | User_SUP);
+	tlb_invalidate(_128MB);
+	if(page[0] != 0xBB) {
+		result = FAIL;
+	}
+	tlb_stats(&full2, &targeted2, &switches2);
+	if(full2 != full || targeted2 != targeted + 1) {
+		result = FAIL;
+	}
+	printf("%u full flushes, %u targeted, %u address space switches\n", full2, targeted2, switches2);
+
+	load_page_dir(Page_Directory);
+	free_user_space(0);
+	free_frame(frame[0]);
+	return result;
+}
+
+/* test_demand_paging()
+ * Description: Loads shell into an empty address space and checks pages
+ *              only become resident when touched: the first program page
+ *              reads the executable's bytes, the top stack page reads zero,
+ *              and a write to the program page leaves a private copy.
+ *              Every frame must come back afterwards. Must run before any
+ *              process exists: it borrows pid 0.
+ * Inputs: None
+ * Outputs: resident pages
+ * Side Effects: Leaves the global page directory loaded
+ */
+int test_demand_paging() {
+	dentry_t dentry;
+	uint8_t first[NUM_OF_MAGIC_CHARS];
+	volatile uint8_t * image = (volatile uint8_t *) (_128MB + EXEC_OFFSET);
+	volatile uint32_t * stack = (volatile uint32_t *) (_128MB + _4MB - FOURKB);
+	uint32_t total, free, regions, free2, i, shared;
+	int old_pid = pid;
+	int result = PASS;
+
+	if(read_dentry_by_name((const uint8_t *) "shell", &dentry) == -1 ||
+	   read_data(dentry.inode, 0, first, NUM_OF_MAGIC_CHARS) != NUM_OF_MAGIC_CHARS) {
+		return FAIL;
+	}
+	frame_stats(&total, &free, &regions);
+	if(init_user_space(0) == -1) {
+		return FAIL;
+	}
+	pid = 0;
+	load_program(dentry.inode, 0);
+	load_page_dir(user_page_dir(0));
+	if(user_resident(0) != 0) {
+		result = FAIL;
+	}
+
+	/* the first page is mapped from the image or read into a frame */
+	for(i = 0; i < NUM_OF_MAGIC_CHARS; i++) {
+		if(image[i] != first[i]) {
+			result = FAIL;
+		}
+	}
+	shared = (user_resident(0) == 0);
+	if(user_resident(0) > 1) {
+		result = FAIL;
+	}
+	if(stack[0] != 0) {
+		result = FAIL;
+	}
+	stack[0] = 0x1234;
+	if(user_resident(0) != 2 - shared) {
+		result = FAIL;
+	}
+	image[0] = first[0];
+	if(user_resident(0) != 2 || image[1] != first[1] || stack[0] != 0x1234) {
+		result = FAIL;
+	}
+	printf("%u pages resident, first page %s\n", user_resident(0), shared ? "was shared" : "was read in");
+
+	load_page_dir(Page_Directory);
+	free_user_space(0);
+	pid = old_pid;
+	frame_stats(&total, &free2, &regions);
+	if(free2 != free) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* test_cow_clone()
+ * Description: Checks the copy-on-write address space copy fork makes:
+ *              the clone shares the parent's frame, the first write on
+ *              either side takes a private copy, and the last sharer gets
+ *              the frame back writable without a copy. Every frame must
+ *              come back afterwards. Must run before any process exists:
+ *              it borrows pids 0 and 1.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: Leaves the global page directory loaded
+ */
+int test_cow_clone() {
+	volatile uint32_t * stack = (volatile uint32_t *) (_128MB + _4MB - FOURKB);
+	uint32_t total, free, regions, free2, shared;
+	int old_pid = pid;
+	int result = PASS;
+
+	frame_stats(&total, &free, &regions);
+	if(init_user_space(0) == -1) {
+		return FAIL;
+	}
+	pid = 0;
+	load_page_dir(user_page_dir(0));
+	stack[0] = 0xAA;
+	if(clone_user_space(0, 1) == -1) {
+		load_page_dir(Page_Directory);
+		free_user_space(0);
+		pid = old_pid;
+		return FAIL;
+	}
+	frame_stats(&total, &shared, &regions);
+
+	/* the parent writes first and gets a copy, the child still sees the old value */
+	stack[0] = 0xBB;
+	frame_stats(&total, &free2, &regions);
+	if(free2 != shared - 1) {
+		result = FAIL;
+	}
+	pid = 1;
+	load_page_dir(user_page_dir(1));
+	if(stack[0] != 0xAA) {
+		result = FAIL;
+	}
+	/* nobody else maps the old frame now, so writing it takes no frame */
+	stack[0] = 0xCC;
+	frame_stats(&total, &free2, &regions);
+	if(free2 != shared - 1 || stack[0] != 0xCC) {
+		result = FAIL;
+	}
+	pid = 0;
+	load_page_dir(user_page_dir(0));
+	if(stack[0] != 0xBB) {
+		result = FAIL;
+	}
+
+	load_page_dir(Page_Directory);
+	free_user_space(0);
+	free_user_space(1);
+	pid = old_pid;
+	frame_stats(&total, &free2, &regions);
+	if(free2 != free) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* test_text_cache()
+ * Description: Loads shell for two processes and checks the last page of
+ *              the executable, which is never mapped out of the image, is
+ *              read in once and shared: both map the same frame, the
+ *              second fault is a cache hit, and a write leaves the writer
+ *              a private copy. The file can't be written while it runs.
+ *              Every frame must come back afterwards. Must
+ *              run before any process exists: it borrows pids 0 and 1.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: Leaves the global page directory loaded
+ */
+int test_text_cache() {
+	dentry_t dentry;
+	volatile uint8_t * last;
+	uint32_t total, free, regions, free2, index, frame, i;
+	uint32_t files, pages, hits, misses, hits2, misses2;
+	uint8_t first;
+	int old_pid = pid;
+	int result = PASS;
+
+	if(read_dentry_by_name((const uint8_t *) "shell", &dentry) == -1 || inodes[dentry.inode].length == 0) {
+		return FAIL;
+	}
+	last = (volatile uint8_t *) ((_128MB + EXEC_OFFSET + inodes[dentry.inode].length - 1) & PAGE_MASK);
+	index = ((uint32_t) last >> 12) & (PTE_SIZE - 1);
+	frame_stats(&total, &free, &regions);
+	text_stats(&files, &pages, &hits, &misses);
+
+	for(i = 0; i < 2; i++) {
+		if(init_user_space(i) == -1) {
+			result = FAIL;
+			continue;
+		}
+		pid = i;
+		load_program(dentry.inode, i);
+		load_page_dir(user_page_dir(i));
+		first = last[0];
+	}
+	text_stats(&files, &pages, &hits2, &misses2);
+	frame = ((uint32_t *) user_page_table(0))[index] & PAGE_MASK;
+	if(result == FAIL || hits2 != hits + 1 || misses2 != misses + 1 ||
+	   frame != (((uint32_t *) user_page_table(1))[index] & PAGE_MASK) ||
+	   user_resident(0) != 0 || user_resident(1) != 0) {
+		result = FAIL;
+	}
+
+	/* pid 1 is loaded, its write must not reach pid 0 */
+	last[0] = first + 1;
+	if(user_resident(1) != 1 || (((uint32_t *) user_page_table(1))[index] & PAGE_MASK) == frame) {
+		result = FAIL;
+	}
+	pid = 0;
+	load_page_dir(user_page_dir(0));
+	if(last[0] != first) {
+		result = FAIL;
+	}
+	printf("%u files cached, %u pages read in\n", files, pages);
+
+	/* a running executable can't be written, once nothing runs it it can */
+	if(write_data(dentry.inode, 0, &first, 0) != -1) {
+		result = FAIL;
+	}
+	load_page_dir(Page_Directory);
+	free_user_space(0);
+	free_user_space(1);
+	pid = old_pid;
+	if(!fs_compressed(dentry.inode) && write_data(dentry.inode, 0, &first, 0) != 0) {
+		result = FAIL;
+	}
+	frame_stats(&total, &free2, &regions);
+	if(free2 != free) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* test_swap()
+ * Description: Writes a page out to the swap disk and faults it back in:
+ *              the clock passes over the page once because it was just
+ *              used, takes it on the next sweep, and the contents come
+ *              back intact, then does the same with an anonymous mmap page
+ *              and unmaps it while it is out. Passes without a swap disk,
+ *              there is nothing to test. Must run before any process
+ *              exists: it borrows pid 0.
+ * Inputs: None
+ * Outputs: swap counters
+ * Side Effects: Leaves the global page directory loaded
+ */
+int test_swap() {
+	volatile uint32_t * stack = (volatile uint32_t *) (_128MB + _4MB - FOURKB);
+	volatile uint32_t * anon;
+	uint32_t total, free, regions, free2, i, flags, swept = 0;
+	uint32_t pass, areas, pages, swapped;
+	swap_stats_t before, after;
+	int old_pid = pid;
+	int result = PASS;
+
+	swap_stats(&before);
+	if(before.slots == 0) {
+		printf("no swap disk\n");
+		return PASS;
+	}
+	frame_stats(&total, &free, &regions);
+	if(init_user_space(0) == -1) {
+		return FAIL;
+	}
+	pid = 0;
+	load_page_dir(user_page_dir(0));
+	for(i = 0; i < FOURKB / sizeof(uint32_t); i++) {
+		stack[i] = i * 0x9E3779B9;
+	}
+
+	cli_and_save(flags);
+	while(user_swapped(0) == 0 && swept < SWAP_SCAN_PASSES && swap_out_page()) {
+		swept++;
+	}
+	restore_flags(flags);
+	if(user_swapped(0) != 1 || user_resident(0) != 0) {
+		result = FAIL;
+	}
+	for(i = 0; i < FOURKB / sizeof(uint32_t); i++) {
+		if(stack[i] != i * 0x9E3779B9) {
+			result = FAIL;
+		}
+	}
+	swap_stats(&after);
+	if(user_swapped(0) != 0 || user_resident(0) != 1 ||
+	   after.ins != before.ins + 1 || after.outs < before.outs + 1) {
+		result = FAIL;
+	}
+	printf("%u outs, in %u cycles\n", after.outs - before.outs, after.in_max);
+
+	/* the clock sweeps the mmap window too, and munmap gives the slot back */
+	anon = (volatile uint32_t *) vma_map(0, 0, FOURKB, VMA_WRITE, 0, 0);
+	if((int32_t) anon == -1) {
+		result = FAIL;
+	} else {
+		for(i = 0; i < FOURKB / sizeof(uint32_t); i++) {
+			anon[i] = ~i;
+		}
+		for(pass = 0; pass < 2; pass++) {
+			swept = 0;
+			cli_and_save(flags);
+			do {
+				vma_stats(0, &areas, &pages, &swapped);
+			} while(swapped == 0 && swept++ < 2 && swap_out_page());
+			restore_flags(flags);
+			if(swapped != 1 || pages != 0) {
+				result = FAIL;
+			}
+			if(pass == 0) {
+				for(i = 0; i < FOURKB / sizeof(uint32_t); i++) {
+					if(anon[i] != ~i) {
+						result = FAIL;
+					}
+				}
+			}
+		}
+		vma_unmap(0, (uint32_t) anon, FOURKB);
+		vma_stats(0, &areas, &pages, &swapped);
+		if(areas != 0 || swapped != 0) {
+			result = FAIL;
+		}
+	}
+
+	load_page_dir(Page_Directory);
+	free_user_space(0);
+	pid = old_pid;
+	swap_stats(&after);
+	frame_stats(&total, &free2, &regions);
+	if(after.used != before.used || free2 != free) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* test_sbrk()
+ * Description: Checks a process's heap starts on a page of its own after
+ *              the program, grows zero filled, stops short of the stack
+ *              and gives its frames back when it shrinks. Must run before
+ *              any process exists: it borrows pid 0.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: Leaves the global page directory loaded
+ */
+int test_sbrk() {
+	dentry_t dentry;
+	volatile uint32_t * heap;
+	uint32_t total, free, regions, free2;
+	int32_t start;
+	int old_pid = pid;
+	int result = PASS;
+
+	if(read_dentry_by_name((const uint8_t *) "shell", &dentry) == -1 || init_user_space(0) == -1) {
+		return FAIL;
+	}
+	frame_stats(&total, &free, &regions);
+	pid = 0;
+	load_program(dentry.inode, 0);
+	load_page_dir(user_page_dir(0));
+
+	start = user_sbrk(0, FOURKB);
+	heap = (volatile uint32_t *) start;
+	if(start == -1 || (start & (FOURKB - 1)) || start <= _128MB + EXEC_OFFSET) {
+		result = FAIL;
+	}
+	if(user_sbrk(0, 0) != start + FOURKB || heap[0] != 0) {
+		result = FAIL;
+	}
+	heap[0] = 0x1234;
+	/* the heap can't grow into the stack or shrink below its start */
+	if(user_sbrk(0, _4MB) != -1 || user_sbrk(0, -2 * FOURKB) != -1) {
+		result = FAIL;
+	}
+	if(user_sbrk(0, -FOURKB) != start + FOURKB) {
+		result = FAIL;
+	}
+	frame_stats(&total, &free2, &regions);
+	if(free2 != free || user_resident(0) != 0) {
+		result = FAIL;
+	}
+
+	load_page_dir(Page_Directory);
+	free_user_space(0);
+	pid = old_pid;
+	return result;
+}
+
+/* test_shm()
+ * Description: Checks two processes that attach a shared memory segment
+ *              see each other's stores, that fork keeps it attached, and
+ *              that the frames go back once the last process detaches.
+ *              Must run before any process exists: it borrows pids 0-2.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: Leaves the global page directory loaded
+ */
+int test_shm() {
+	volatile uint32_t * seg0, * seg1;
+	uint32_t total, free, regions, free2, i;
+	int32_t id;
+	int old_pid = pid;
+	int result = PASS;
+
+	frame_stats(&total, &free, &regions);
+	id = shm_get(0x1234, 2 * FOURKB);
+	if(id == -1 || init_user_space(0) == -1 || init_user_space(1) == -1) {
+		return FAIL;
+	}
+	if(shm_get(0x1234, FOURKB) != id || shm_get(0x1234, 3 * FOURKB) != -1 || shm_get(0x5678, 0) != -1) {
+		result = FAIL;
+	}
+	seg0 = (volatile uint32_t *) shm_map(0, id);
+	seg1 = (volatile uint32_t *) shm_map(1, id);
+	if((int32_t) seg0 == -1 || (int32_t) seg1 == -1 || shm_map(0, id) != (int32_t) seg0) {
+		result = FAIL;
+	}
+	if(clone_user_space(1, 2) == -1) {
+		result = FAIL;
+	}
+
+	pid = 0;
+	load_page_dir(user_page_dir(0));
+	for(i = 0; i < 2 * FOURKB / sizeof(uint32_t); i++) {
+		if(seg0[i] != 0) {
+			result = FAIL;
+		}
+	}
+	seg0[0] = 0xAB;
+	seg0[FOURKB / sizeof(uint32_t)] = 0xCD;
+	for(i = 1; i <= 2; i++) {
+		pid = i;
+		load_page_dir(user_page_dir(i));
+		if(seg1[0] != 0xAB || seg1[FOURKB / sizeof(uint32_t)] != 0xCD) {
+			result = FAIL;
+		}
+	}
+	/* the segment isn't copy-on-write, the forked copy writes the same frame */
+	seg1[0] = 0xEF;
+	if(shm_unmap(2, (uint32_t) seg1) != 0 || shm_unmap(2, (uint32_t) seg1) != -1) {
+		result = FAIL;
+	}
+	pid = 0;
+	load_page_dir(user_page_dir(0));
+	if(seg0[0] != 0xEF) {
+		result = FAIL;
+	}
+
+	load_page_dir(Page_Directory);
+	if(shm_unmap(0, (uint32_t) seg0) != 0) {
+		result = FAIL;
+	}
+	free_user_space(0);
+	free_user_space(1);
+	free_user_space(2);
+	pid = old_pid;
+	frame_stats(&total, &free2, &regions);
+	if(free2 != free) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* test_mmap()
+ * Description: Checks anonymous mappings fault in zero filled and
+ *              writable, file mappings read the file and refuse writes,
+ *              and munmap splits an area and frees its pages. Must run
+ *              before any process exists: it borrows pid 0.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: Leaves the global page directory loaded
+ */
+int test_mmap() {
+	dentry_t dentry;
+	uint8_t first[NUM_OF_MAGIC_CHARS];
+	volatile uint32_t * anon;
+	volatile uint8_t * file;
+	uint32_t total, free, regions, free2, i;
+	int old_pid = pid;
+	int result = PASS;
+
+	if(read_dentry_by_name((const uint8_t *) "frame0.txt", &dentry) == -1 ||
+	   read_data(dentry.inode, 0, first, NUM_OF_MAGIC_CHARS) != NUM_OF_MAGIC_CHARS || init_user_space(0) == -1) {
+		return FAIL;
+	}
+	frame_stats(&total, &free, &regions);
+	pid = 0;
+	load_page_dir(user_page_dir(0));
+
+	anon = (volatile uint32_t *) vma_map(0, 0, 3 * FOURKB, VMA_WRITE, 0, 0);
+	file = (volatile uint8_t *) vma_map(0, 0, FOURKB, VMA_FILE, dentry.inode, 0);
+	if((int32_t) anon != MMAP_START || (int32_t) file != MMAP_START + 3 * FOURKB ||
+	   vma_map(0, 0, FOURKB, VMA_FILE, dentry.inode, 1) != -1) {
+		result = FAIL;
+	}
+	for(i = 0; i < 3; i++) {
+		if(anon[i * FOURKB / sizeof(uint32_t)] != 0) {
+			result = FAIL;
+		}
+		anon[i * FOURKB / sizeof(uint32_t)] = i + 1;
+	}
+	for(i = 0; i < NUM_OF_MAGIC_CHARS; i++) {
+		if(file[i] != first[i]) {
+			result = FAIL;
+		}
+	}
+	/* nothing is mapped past the areas, and a file area can't be written */
+	if(handle_page_fault(MMAP_START + 4 * FOURKB, 0) != -1 || handle_page_fault((uint32_t) file, PF_PRESENT | PF_WRITE) != -1) {
+		result = FAIL;
+	}
+	/* nor can the file itself while it is mapped */
+	if(write_data(dentry.inode, 0, first, 0) != -1) {
+		result = FAIL;
+	}
+
+	/* punch out the middle page, the pages around it keep their data */
+	if(vma_unmap(0, (uint32_t) anon + FOURKB, FOURKB) != 0 || handle_page_fault((uint32_t) anon + FOURKB, 0) != -1) {
+		result = FAIL;
+	}
+	if(anon[0] != 1 || anon[2 * FOURKB / sizeof(uint32_t)] != 3) {
+		result = FAIL;
+	}
+	/* the hole is reused for a hint that fits it */
+	if(vma_map(0, (uint32_t) anon + FOURKB, FOURKB, VMA_WRITE, 0, 0) != (int32_t) anon + FOURKB) {
+		result = FAIL;
+	}
+
+	load_page_dir(Page_Directory);
+	free_user_space(0);
+	pid = old_pid;
+	frame_stats(&total, &free2, &regions);
+	if(free2 != free) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* test_zero_pool()
+ * Description: Checks frames from the zero pool come out zero filled and
+ *              are counted as hits, that an empty pool still hands out
+ *              zeroed frames, and that pooled frames count as free.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: Leaves the pool full
+ */
+int test_zero_pool() {
+	uint32_t total, free, regions, free2;
+	uint32_t depth, hits, misses, depth2, hits2, misses2;
+	uint32_t frame, i, flags;
+	uint32_t * page = (uint32_t *) SCRATCH_ADDR;
+	uint32_t frames[ZERO_POOL_SIZE + 1];
+	int result = PASS;
+
+	refill_zero_pool(ZERO_POOL_SIZE);
+	frame_stats(&total, &free, &regions);
+	zero_pool_stats(&depth, &hits, &misses);
+	if(depth != ZERO_POOL_SIZE) {
+		result = FAIL;
+	}
+
+	/* dirty a frame and give it back, whoever gets it next must see zeros */
+	cli_and_save(flags);
+	frame = alloc_frame();
+	Page_Table[SCRATCH_PTE] = frame | PRESENT | R_W;
+	tlb_invalidate(SCRATCH_ADDR);
+	memset(page, 0xFF, FOURKB);
+	Page_Table[SCRATCH_PTE] = R_W;
+	tlb_invalidate(SCRATCH_ADDR);
+	restore_flags(flags);
+	free_frame(frame);
+
+	/* drain the pool and take one more, which has to be zeroed on the spot */
+	for(i = 0; i <= ZERO_POOL_SIZE; i++) {
+		frames[i] = alloc_zeroed_frame();
+		if(frames[i] == 0) {
+			result = FAIL;
+			continue;
+		}
+		cli_and_save(flags);
+		Page_Table[SCRATCH_PTE] = frames[i] | PRESENT | R_W;
+		tlb_invalidate(SCRATCH_ADDR);
+		if(page[0] != 0 || page[FOURKB / sizeof(uint32_t) - 1] != 0) {
+			result = FAIL;
+		}
+		Page_Table[SCRATCH_PTE] = R_W;
+		tlb_invalidate(SCRATCH_ADDR);
+		restore_flags(flags);
+	}
+	zero_pool_stats(&depth2, &hits2, &misses2);
+	if(depth2 != 0 || hits2 != hits + ZERO_POOL_SIZE || misses2 != misses + 1) {
+		result = FAIL;
+	}
+	for(i = 0; i <= ZERO_POOL_SIZE; i++) {
+		free_frame(frames[i]);
+	}
+
+	refill_zero_pool(ZERO_POOL_SIZE);
+	frame_stats(&total, &free2, &regions);
+	if(free2 != free) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* test_memstat()
+ * Description: Reads the memstat pseudo-file through a descriptor of a
+ *              stand-in PCB and checks the report starts with the frame
+ *              counts, reads in pieces add up to the whole report and
+ *              seeking to 0 takes a new one.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: None
+ */
+int test_memstat() {
+	static int8_t whole[MEMSTAT_SIZE];
+	static int8_t pieces[MEMSTAT_SIZE];
+	PCB pcb;
+	file_desc_t desc;
+	PCB * old_pcb = current_process->pcb;
+	int32_t len, n, got = 0;
+	int result = PASS;
+
+	memset(&pcb, 0, sizeof(PCB));
+	memset(&desc, 0, sizeof(file_desc_t));
+	pcb.file_ops[STD_OUT + 1] = &desc;
+	current_process->pcb = &pcb;
+
+	len = memstat_read(STD_OUT + 1, whole, MEMSTAT_SIZE);
+	if(len <= 0 || strncmp(whole, "frames: ", 8) != 0 || memstat_read(STD_OUT + 1, whole, MEMSTAT_SIZE) != 0) {
+		result = FAIL;
+	}
+	if(memstat_write(STD_OUT + 1, whole, len) != -1 || memstat_lseek(STD_OUT + 1, 0, SEEK_SET) != 0) {
+		result = FAIL;
+	}
+	/* nothing allocates in between, so the new report is the same text */
+	while((n = memstat_read(STD_OUT + 1, pieces + got, 7)) > 0) {
+		got += n;
+	}
+	if(got != len || strncmp(whole, pieces, len) != 0) {
+		result = FAIL;
+	}
+
+	current_process->pcb = old_pcb;
+	return result;
+}
+
 int test_rtc() {
 	const char *rtc = "rtc";
 	rtc_open((const uint8_t *)rtc); 
@@ -521,11 +1458,582 @@ int test_rtc() {
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
 
+/* ----------------------------------------------------BENCHMARK FUNCTIONS-----------------------------------------------------------*/
+#define BENCH_ROUNDS 100
+#define BENCH_NAME_LEN 8
+#define BENCH_BUF_SIZE 65536
+#define PIT_CH2_PORT 0x42
+#define PIT_CH2_GATE 0x61   /* bit 0 gates channel 2, bit 5 is its output */
+#define PIT_CH2_MODE0 0xB0  /* channel 2, lobyte/hibyte, interrupt on terminal count */
+#define CALIBRATE_MS 10
+
+static bootblock bench_boot;      /* synthetic directory with every dentry in use */
+static dentry_index_t bench_index;
+
+static uint8_t bench_buf[BENCH_BUF_SIZE];
+
+/* calibrate_tsc_mhz()
+ * Description: Measures how many time stamp counter ticks happen per
+ *              microsecond by counting them across a 10 ms one-shot on
+ *              PIT channel 2, which doesn't need interrupts.
+ * Inputs: none
+ * Outputs: none
+ * Returns: TSC frequency in MHz
+ * Side Effects: Reprograms PIT channel 2 (the speaker channel)
+ */
+static uint32_t calibrate_tsc_mhz() {
+	uint32_t count = NATURAL_FREQ / (1000 / CALIBRATE_MS);
+	uint32_t start;
+
+	/* gate channel 2 on with the speaker disconnected, then arm the one-shot */
+	outb((inb(PIT_CH2_GATE) & ~0x02) | 0x01, PIT_CH2_GATE);
+	outb(PIT_CH2_MODE0, PIT_CMD_PORT);
+	outb(count & LOWER_MASK, PIT_CH2_PORT);
+	outb((count & UPPER_MASK) >> 8, PIT_CH2_PORT);
+
+	start = rdtsc();
+	while(!(inb(PIT_CH2_GATE) & 0x20));
+	return (rdtsc() - start) / (CALIBRATE_MS * 1000);
+}
+
+/* scan_dentry_by_name()
+ * Description: The linear scan read_dentry_by_name used before the dentry
+ *              index existed, kept as the baseline for bench_dentry_lookup.
+ * Inputs: boot - boot block to scan
+ *         fname - name to look up
+ * Outputs: none
+ * Returns: index of the entry, -1 if not found
+ * Side Effects: None
+ */
+static int32_t scan_dentry_by_name(const bootblock * boot, const uint8_t * fname) {
+	uint32_t i;
+	for(i = 0; i < boot->num_entries; i++) {
+		uint32_t length = strlen((const int8_t *) boot->entries[i].f_name);
+		length = MAX_FILE_NAME_LEN;
+		if(strncmp((const int8_t *)fname, (const int8_t *)boot->entries[i].f_name, length) == 0) {
+			if(strncmp((const int8_t *)fname, (const int8_t *)boot->entries[i].f_name, length) == 0) {
+				return i;
+			}
+		}
+	}
+	return -1;
+}
+
+/* bench_dentry_lookup()
+ * Description: Times the linear dentry scan against the hashed dentry index
+ *              on a full 63-entry directory, looking up every name once per
+ *              round plus one name that isn't there.
+ * Inputs: none
+ * Outputs: average cycles per lookup for each method
+ * Returns: PASS if both methods agree on every lookup, FAIL otherwise
+ * Side Effects: None
+ */
+int bench_dentry_lookup() {
+	TEST_HEADER;
+	int8_t names[NUM_DENTRIES + 1][BENCH_NAME_LEN];
+	uint32_t i, round, start, scan_cycles, index_cycles;
+	int32_t found = 0;
+	int result = PASS;
+
+	/* fill the directory with "file0" ... "file62", the last name is never added */
+	bench_boot.num_entries = NUM_DENTRIES;
+	for(i = 0; i <= NUM_DENTRIES; i++) {
+		strcpy(names[i], "file");
+		itoa(i, names[i] + 4, 10);
+		if(i < NUM_DENTRIES) {
+			strncpy((int8_t *) bench_boot.entries[i].f_name, names[i], MAX_FILE_NAME_LEN);
+			bench_boot.entries[i].f_type = EXEC_TYPE;
+			bench_boot.entries[i].inode = i;
+		}
+	}
+	dentry_index_build(&bench_index, &bench_boot);
+
+	for(i = 0; i <= NUM_DENTRIES; i++) {
+		if(scan_dentry_by_name(&bench_boot, (uint8_t *) names[i]) !=
+		   dentry_index_lookup(&bench_index, &bench_boot, (uint8_t *) names[i])) {
+			result = FAIL;
+		}
+	}
+
+	start = rdtsc();
+	for(round = 0; round < BENCH_ROUNDS; round++) {
+		for(i = 0; i <= NUM_DENTRIES; i++) {
+			found += scan_dentry_by_name(&bench_boot, (uint8_t *) names[i]);
+		}
+	}
+	scan_cycles = rdtsc() - start;
+
+	start = rdtsc();
+	for(round = 0; round < BENCH_ROUNDS; round++) {
+		for(i = 0; i <= NUM_DENTRIES; i++) {
+			found -= dentry_index_lookup(&bench_index, &bench_boot, (uint8_t *) names[i]);
+		}
+	}
+	index_cycles = rdtsc() - start;
+
+	/* both loops summed the same indices, so found should be back to 0 */
+	if(found != 0) {
+		result = FAIL;
+	}
+	printf("linear scan: %u cycles/lookup\n", scan_cycles / (BENCH_ROUNDS * (NUM_DENTRIES + 1)));
+	printf("hash index:  %u cycles/lookup\n", index_cycles / (BENCH_ROUNDS * (NUM_DENTRIES + 1)));
+	return result;
+}
+
+/* test_dentry_index()
+ * Description: Builds the dentry index over a full 63-entry directory on
+ *              top of a table that was all zeros, the way a stale table
+ *              looks. Every slot but the 63 used ones must read empty, and
+ *              every name must be found, including those stored in the
+ *              upper half of the table.
+ * Inputs: none
+ * Outputs: none
+ * Returns: PASS if the index is clean and every name is found, FAIL otherwise
+ * Side Effects: None
+ */
+int test_dentry_index() {
+	TEST_HEADER;
+	int8_t name[BENCH_NAME_LEN];
+	uint32_t i, used = 0, upper = 0;
+	uint16_t entry;
+	int result = PASS;
+
+	bench_boot.num_entries = NUM_DENTRIES;
+	for(i = 0; i < NUM_DENTRIES; i++) {
+		strcpy(name, "file");
+		itoa(i, name + 4, 10);
+		strncpy((int8_t *) bench_boot.entries[i].f_name, name, MAX_FILE_NAME_LEN);
+		bench_boot.entries[i].f_type = EXEC_TYPE;
+		bench_boot.entries[i].inode = i;
+	}
+	memset(bench_index.slot, 0, sizeof(bench_index.slot));
+	dentry_index_build(&bench_index, &bench_boot);
+
+	for(i = 0; i < DENTRY_HASH_SIZE; i++) {
+		entry = bench_index.slot[i];
+		if(entry == DENTRY_HASH_EMPTY) {
+			continue;
+		}
+		used++;
+		if(entry >= NUM_DENTRIES || dentry_index_lookup(&bench_index, &bench_boot, bench_boot.entries[entry].f_name) != entry) {
+			result = FAIL;
+		}
+		if(i >= DENTRY_HASH_SIZE / 2) {
+			upper++;
+		}
+	}
+	if(used != NUM_DENTRIES || upper == 0) {
+		result = FAIL;
+	}
+	if(dentry_index_lookup(&bench_index, &bench_boot, (const uint8_t *) "nosuchfile") != -1) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* read_data_bytewise()
+ * Description: The byte at a time copy loop read_data used before it copied
+ *              whole block spans, kept as the baseline for bench_read_data.
+ * Inputs: same as read_data
+ * Outputs: none
+ * Returns: number of bytes copied, -1 on failure
+ * Side Effects: None
+ */
+static int32_t read_data_bytewise(uint32_t inode_idx, uint32_t offset, uint8_t* buf, uint32_t read_length) {
+	bootblock * boot = (bootblock *) FS_START->mod_start;
+	datablock * blocks = (datablock *) FS_START->mod_start + (1 + boot->num_inodes);
+	inode * inode_block = inodes + inode_idx;
+	uint32_t block, data_idx, buff_idx = 0;
+
+	if(offset >= inode_block->length) {
+		return -1;
+	}
+	if(offset + read_length > inode_block->length) {
+		read_length = inode_block->length - offset;
+	}
+	block = offset / BLOCK_SIZE;
+	data_idx = offset % BLOCK_SIZE;
+	while(read_length) {
+		buf[buff_idx] = blocks[inode_block->data_block[block]].data[data_idx];
+		read_length--;
+		data_idx++;
+		buff_idx++;
+		if(data_idx >= BLOCK_SIZE) {
+			block++;
+			data_idx = 0;
+		}
+	}
+	return buff_idx;
+}
+
+/* bench_read_file()
+ * Description: Reads a whole file front to back in requests of read_size
+ *              bytes and reports the throughput of one pass.
+ * Inputs: read_fn - read_data or the bytewise baseline
+ *         file - inode of the file to read
+ *         read_size - bytes asked for per call
+ *         mhz - TSC frequency from calibrate_tsc_mhz
+ * Outputs: none
+ * Returns: throughput in MB/s
+ * Side Effects: Overwrites bench_buf
+ */
+static uint32_t bench_read_file(int32_t (*read_fn)(uint32_t, uint32_t, uint8_t *, uint32_t),
+                                uint32_t file, uint32_t read_size, uint32_t mhz) {
+	uint32_t round, offset, start, cycles;
+	uint32_t length = (inodes + file)->length;
+	int32_t ret;
+
+	start = rdtsc();
+	for(round = 0; round < BENCH_ROUNDS; round++) {
+		for(offset = 0; offset < length; offset += ret) {
+			ret = read_fn(file, offset, bench_buf, read_size);
+			if(ret <= 0) {
+				break;
+			}
+		}
+	}
+	cycles = (rdtsc() - start) / BENCH_ROUNDS;
+	/* bytes per microsecond is MB/s */
+	return cycles ? (length * mhz) / cycles : 0;
+}
+
+/* bench_read_data()
+ * Description: Compares read_data against the old byte at a time loop when
+ *              reading a file in 4 KB requests, 64 KB requests and a single
+ *              whole-file request, and checks both return the same bytes.
+ * Inputs: fname - file to read, should be at least a few blocks long
+ * Outputs: MB/s for every request size and method
+ * Returns: PASS if the data matches, FAIL otherwise
+ * Side Effects: Reprograms PIT channel 2
+ */
+int bench_read_data(const char * fname) {
+	TEST_HEADER;
+	static uint8_t check_buf[BENCH_BUF_SIZE];
+	uint32_t sizes[3] = {_4KB, BENCH_BUF_SIZE, BENCH_BUF_SIZE};
+	int8_t * labels[3] = {"4 KB", "64 KB", "whole file"};
+	dentry_t dentry;
+	uint32_t mhz, length, i;
+	int32_t ret;
+
+	if(read_dentry_by_name((const uint8_t *) fname, &dentry) == -1) {
+		printf("File not found!\n");
+		return FAIL;
+	}
+	length = (inodes + dentry.inode)->length;
+	if(length > BENCH_BUF_SIZE) {
+		length = BENCH_BUF_SIZE;
+	}
+	/* a whole-file request is just one call for the file's length */
+	sizes[2] = length;
+
+	ret = read_data(dentry.inode, 0, bench_buf, length);
+	if(ret != read_data_bytewise(dentry.inode, 0, check_buf, length)) {
+		return FAIL;
+	}
+	for(i = 0; i < ret; i++) {
+		if(bench_buf[i] != check_buf[i]) {
+			return FAIL;
+		}
+	}
+
+	mhz = calibrate_tsc_mhz();
+	printf("%s: %u bytes, TSC at %u MHz\n", fname, (inodes + dentry.inode)->length, mhz);
+	for(i = 0; i < 3; i++) {
+		printf("%s reads: block copy %u MB/s, bytewise %u MB/s\n", labels[i],
+		       bench_read_file(read_data, dentry.inode, sizes[i], mhz),
+		       bench_read_file(read_data_bytewise, dentry.inode, sizes[i], mhz));
+	}
+	return PASS;
+}
+
+/* read_data_cold()
+ * Description: read_data that empties the decompressed chunk cache at the
+ *              start of every pass over a file, so compressed reads in
+ *              bench_read_lz4 pay for decompressing each chunk once per pass.
+ * Inputs: same as read_data
+ * Outputs: none
+ * Returns: same as read_data
+ * Side Effects: Flushes the chunk cache when offset is 0
+ */
+static int32_t read_data_cold(uint32_t inode_idx, uint32_t offset, uint8_t* buf, uint32_t read_length) {
+	if(offset == 0) {
+		lz4_cache_flush();
+	}
+	return read_data(inode_idx, offset, buf, read_length);
+}
+
+/* bench_read_lz4()
+ * Description: Compares reading a raw file against reading an LZ4 compressed
+ *              copy of it, with 100 byte, 4 KB and whole-file requests. Pack
+ *              an image with "tools/lz4img -k filesys_img out.img fish" to get
+ *              fish compressed and fish.raw next to it.
+ * Inputs: raw_name - uncompressed file
+ *         lz4_name - compressed file with the same contents
+ * Outputs: MB/s for every request size, and chunk cache hits and misses
+ * Returns: PASS if both files read back the same, FAIL otherwise
+ * Side Effects: Reprograms PIT channel 2, flushes the chunk cache
+ */
+int bench_read_lz4(const char * raw_name, const char * lz4_name) {
+	TEST_HEADER;
+	static uint8_t check_buf[BENCH_BUF_SIZE];
+	uint32_t sizes[3] = {100, _4KB, BENCH_BUF_SIZE};
+	int8_t * labels[3] = {"100 B", "4 KB", "whole file"};
+	dentry_t raw, packed;
+	uint32_t mhz, length, i, hits, misses, hits_before, misses_before;
+	int32_t ret;
+
+	if(read_dentry_by_name((const uint8_t *) raw_name, &raw) == -1 ||
+	   read_dentry_by_name((const uint8_t *) lz4_name, &packed) == -1) {
+		printf("File not found!\n");
+		return FAIL;
+	}
+	if(!fs_compressed(packed.inode)) {
+		printf("%s is not compressed!\n", lz4_name);
+		return FAIL;
+	}
+	length = (inodes + raw.inode)->length;
+	if(length != (inodes + packed.inode)->length) {
+		return FAIL;
+	}
+	if(length > BENCH_BUF_SIZE) {
+		length = BENCH_BUF_SIZE;
+	}
+	sizes[2] = length;
+
+	ret = read_data(raw.inode, 0, bench_buf, length);
+	if(ret != read_data_cold(packed.inode, 0, check_buf, length)) {
+		return FAIL;
+	}
+	for(i = 0; i < ret; i++) {
+		if(bench_buf[i] != check_buf[i]) {
+			return FAIL;
+		}
+	}
+
+	mhz = calibrate_tsc_mhz();
+	printf("%s: %u bytes, TSC at %u MHz\n", lz4_name, length, mhz);
+	for(i = 0; i < 3; i++) {
+		lz4_cache_stats(&hits_before, &misses_before);
+		ret = bench_read_file(read_data_cold, packed.inode, sizes[i], mhz);
+		lz4_cache_stats(&hits, &misses);
+		printf("%s reads: raw %u MB/s, lz4 %u MB/s (%u hits, %u misses per pass)\n", labels[i],
+		       bench_read_file(read_data, raw.inode, sizes[i], mhz), ret,
+		       (hits - hits_before) / BENCH_ROUNDS, (misses - misses_before) / BENCH_ROUNDS);
+	}
+	return PASS;
+}
+
+#define BENCH_ALLOCS 1024
+#define BENCH_MIN_ALLOC 16
+#define BENCH_MAX_ALLOC 8192
+
+/* bench_rand()
+ * Description: Small linear congruential generator so benchmark workloads
+ *              are the same on every run.
+ * Inputs: state - generator state, updated
+ * Outputs: none
+ * Returns: next pseudo-random number
+ * Side Effects: None
+ */
+static uint32_t bench_rand(uint32_t * state) {
+	*state = *state * 1103515245 + 12345;
+	return *state >> 16;
+}
+
+/* bench_kmalloc()
+ * Description: Times kmalloc/kfree on three workloads: one 64 byte block
+ *              allocated and freed over and over, BENCH_ALLOCS mixed sizes
+ *              allocated then freed in the same order, and the same sizes
+ *              with every other block freed early so the heap fragments.
+ * Inputs: none
+ * Outputs: cycles per call for each workload, peak heap use, internal waste
+ *          and how fragmented the free space was
+ * Returns: PASS if every allocation succeeded and the heap merged back, FAIL otherwise
+ * Side Effects: Reprograms PIT channel 2
+ */
+int bench_kmalloc() {
+	TEST_HEADER;
+	static void * live[BENCH_ALLOCS];
+	static uint32_t sizes[BENCH_ALLOCS];
+	kheap_stats_t before, frag, after;
+	uint32_t i, round, start, cycles, mhz, granted, seed = 391;
+	int result = PASS;
+
+	for(i = 0; i < BENCH_ALLOCS; i++) {
+		sizes[i] = BENCH_MIN_ALLOC + bench_rand(&seed) % (BENCH_MAX_ALLOC - BENCH_MIN_ALLOC);
+	}
+	mhz = calibrate_tsc_mhz();
+	kheap_stats(&before);
+
+	start = rdtsc();
+	for(round = 0; round < BENCH_ROUNDS * BENCH_ALLOCS; round++) {
+		kfree(kmalloc(64));
+	}
+	cycles = (rdtsc() - start) / (BENCH_ROUNDS * BENCH_ALLOCS);
+	printf("64 B pairs:  %u cycles/pair, %u K pairs/s\n", cycles, cycles ? mhz * 1000 / cycles : 0);
+
+	start = rdtsc();
+	for(round = 0; round < BENCH_ROUNDS; round++) {
+		for(i = 0; i < BENCH_ALLOCS; i++) {
+			live[i] = kmalloc(sizes[i]);
+		}
+		for(i = 0; i < BENCH_ALLOCS; i++) {
+			if(live[i] == NULL) {
+				result = FAIL;
+			}
+			kfree(live[i]);
+		}
+	}
+	cycles = (rdtsc() - start) / (BENCH_ROUNDS * BENCH_ALLOCS);
+	printf("mixed sizes: %u cycles/pair\n", cycles);
+
+	/* free the even blocks, then refill the holes with the odd sizes */
+	for(i = 0; i < BENCH_ALLOCS; i++) {
+		live[i] = kmalloc(sizes[i]);
+	}
+	start = rdtsc();
+	for(i = 0; i < BENCH_ALLOCS; i += 2) {
+		kfree(live[i]);
+		live[i] = NULL;
+	}
+	kheap_stats(&frag);
+	for(i = 0; i < BENCH_ALLOCS; i += 2) {
+		live[i] = kmalloc(sizes[i + 1]);
+	}
+	cycles = (rdtsc() - start) / BENCH_ALLOCS;
+	printf("holes:       %u cycles/call\n", cycles);
+	for(i = 0; i < BENCH_ALLOCS; i++) {
+		kfree(live[i]);
+	}
+
+	kheap_stats(&after);
+	granted = after.granted - before.granted;
+	printf("peak %u KB of %u KB, %u%% of granted bytes unused by callers\n", after.peak >> 10,
+	       after.heap_size >> 10, (granted - (after.requested - before.requested)) / (granted / 100));
+	printf("with holes: %u KB free in %u blocks, largest %u KB\n", frag.free_bytes >> 10,
+	       frag.free_blocks, frag.largest_free >> 10);
+	if(after.failures != before.failures || after.in_use != before.in_use ||
+	   after.largest_free != before.largest_free) {
+		result = FAIL;
+	}
+	return result;
+}
+
+#define BENCH_SWITCHES 10000
+#define BENCH_TOUCH_PAGES 8
+
+/* touch_after_switch()
+ * Description: Reads a few user pages and the kernel heap the way a process
+ *              does right after being switched to, so TLB refills are counted.
+ * Inputs: heap - a kmalloc'd buffer of BENCH_TOUCH_PAGES pages
+ * Outputs: none
+ * Returns: sum of the words read
+ * Side Effects: None
+ */
+static uint32_t touch_after_switch(volatile uint32_t * heap) {
+	uint32_t i, sum = 0;
+	for(i = 0; i < BENCH_TOUCH_PAGES; i++) {
+		sum += *(volatile uint32_t *) (_128MB + i * FOURKB);
+		sum += heap[i * FOURKB / sizeof(uint32_t)];
+	}
+	return sum;
+}
+
+/* bench_context_switch()
+ * Description: Times switching address spaces between two processes the old
+ *              way (rewrite the 128 MB and video entries of the one global
+ *              page directory, flushing the TLB twice) against loading each
+ *              process's own page directory into CR3 once. Both include
+ *              touching a few user and kernel pages after the switch.
+ *              Must run before any process exists: it borrows pids 0 and 1.
+ * Inputs: none
+ * Outputs: cycles per switch for each method
+ * Returns: PASS if both methods see the right memory, FAIL otherwise
+ * Side Effects: Leaves the global page directory loaded
+ */
+int bench_context_switch() {
+	TEST_HEADER;
+	uint32_t i, j, frame, start, old_cycles, new_cycles, flags, sum = 0;
+	volatile uint32_t * heap = kmalloc(BENCH_TOUCH_PAGES * FOURKB);
+	int result = PASS;
+
+	if(heap == NULL) {
+		return FAIL;
+	}
+	/* give each process the pages touch_after_switch reads and tag the
+	 * first word of its memory with its pid */
+	for(i = 0; i < 2; i++) {
+		frame = (init_user_space(i) == -1) ? 0 : 1;
+		for(j = 0; j < BENCH_TOUCH_PAGES && frame != 0; j++) {
+			frame = alloc_frame();
+			if(frame != 0) {
+				map_user_page(i, _128MB + j * FOURKB, frame, PRESENT | R_W | User_SUP);
+			}
+		}
+		if(frame == 0) {
+			load_page_dir(Page_Directory);
+			free_user_space(0);
+			free_user_space(1);
+			kfree((void *) heap);
+			return FAIL;
+		}
+		load_page_dir(user_page_dir(i));
+		*(uint32_t *) _128MB = i;
+	}
+
+	cli_and_save(flags);
+	start = rdtsc();
+	for(i = 0; i < BENCH_SWITCHES; i++) {
+		Page_Directory[USER_PDE] = user_page_table(i & 1) | PRESENT | R_W | User_SUP;
+		load_page_dir(Page_Directory);
+		Page_Directory[USR_VIDEO_PDE] = (uint32_t) Page_Table | PRESENT | R_W | User_SUP;
+		Page_Table[VIDEO_PTE] = VIDEO_MEMORY_START | PRESENT | R_W | User_SUP;
+		flush_TLB();
+		sum += touch_after_switch(heap);
+	}
+	old_cycles = (rdtsc() - start) / BENCH_SWITCHES;
+	if(*(uint32_t *) _128MB != 1) {
+		result = FAIL;
+	}
+
+	start = rdtsc();
+	for(i = 0; i < BENCH_SWITCHES; i++) {
+		load_page_dir(user_page_dir(i & 1));
+		sum += touch_after_switch(heap);
+	}
+	new_cycles = (rdtsc() - start) / BENCH_SWITCHES;
+	if(*(uint32_t *) _128MB != 1) {
+		result = FAIL;
+	}
+	restore_flags(flags);
+
+	/* put the global directory back the way init_paging left it */
+	load_page_dir(Page_Directory);
+	Page_Directory[USER_PDE] = R_W;
+	Page_Directory[USR_VIDEO_PDE] = R_W;
+	Page_Table[VIDEO_PTE] = R_W;
+	flush_TLB();
+	free_user_space(0);
+	free_user_space(1);
+	kfree((void *) heap);
+
+	printf("rewrite global directory: %u cycles/switch\n", old_cycles);
+	printf("per-process CR3 load:     %u cycles/switch (checksum %u)\n", new_cycles, sum);
+	return result;
+}
 
 /* Test suite entry point */
 void launch_tests(){
 	//TEST_OUTPUT("idt_test", idt_test());
 
+/* ----------------------------------------------------BENCHMARKS-----------------------------------------------------------*/
+	// TEST_OUTPUT("dentry index", test_dentry_index());
+	// TEST_OUTPUT("dentry lookup benchmark", bench_dentry_lookup());
+	// TEST_OUTPUT("read_data throughput benchmark", bench_read_data("fish"));
+	// TEST_OUTPUT("compressed read benchmark", bench_read_lz4("fish.raw", "fish"));
+	// TEST_OUTPUT("kmalloc throughput benchmark", bench_kmalloc());
+	// TEST_OUTPUT("context switch benchmark", bench_context_switch());
+
 /* ----------------------------------------------------CHECKPOINT 2 TEST CASES-----------------------------------------------------------*/
 	// TEST_OUTPUT("testing terminal driver", test_terminal());
 
@@ -542,6 +2050,22 @@ void launch_tests(){
 	//TEST_OUTPUT("filesystem", test_fileSystem("fish", 0, 0, 0, 8500));
 	//TEST_OUTPUT("filesystem", test_fileSystem("pingpong", 8, 0, 1, 8500));
 
+	// TEST_OUTPUT("extent maps", test_extents());
+	// TEST_OUTPUT("writing a file", test_fs_write());
+	// TEST_OUTPUT("kernel heap", test_kmalloc());
+	// TEST_OUTPUT("object caches", test_slab());
+	// TEST_OUTPUT("frame allocator", test_frames());
+	// TEST_OUTPUT("targeted TLB invalidation", test_tlb());
+	// TEST_OUTPUT("demand paging", test_demand_paging());
+	// TEST_OUTPUT("copy-on-write clone", test_cow_clone());
+	// TEST_OUTPUT("user heap", test_sbrk());
+	// TEST_OUTPUT("shared memory", test_shm());
+	// TEST_OUTPUT("mmap", test_mmap());
+	// TEST_OUTPUT("zero page pool", test_zero_pool());
+	// TEST_OUTPUT("memstat file", test_memstat());
+	// TEST_OUTPUT("text cache", test_text_cache());
+	// TEST_OUTPUT("swap", test_swap());
+
 	// TEST_OUTPUT("testing rtc driver", test_rtc());
 	
 /* ----------------------------------------------------CHECKPOINT 1 TEST CASES-----------------------------------------------------------*/
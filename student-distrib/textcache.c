@@ -0,0 +1,166 @@
+#include "textcache.h"
+#include "frame.h"
+#include "page.h"
+#include "malloc.h"
+#include "lib.h"
+#include "filesystem.h"
+
+/* Executables whose blocks can't be mapped straight out of the filesystem
+ * image (the image isn't page aligned, the file is compressed, or the page
+ * is the file's partial last one) would otherwise get a private copy of
+ * every page in every process. Here each page is read once per executable
+ * and shared: a process only gets its own copy of the pages it writes,
+ * which is its data, never its text. */
+static text_file_t text_files[TEXT_CACHE_FILES];
+static uint32_t text_hits;   /* faults served by a page already read in */
+static uint32_t text_misses; /* faults that read the page in            */
+
+/* text_get()
+ * Description: Registers one more process running an executable.
+ * Inputs: inode - inode of the executable
+ *         length - bytes of the file that are mapped
+ * Outputs: none
+ * Returns: the file's slot, for text_frame and text_put, -1 if every slot
+ *          is taken by other files or the kernel heap is out of memory
+ * Side Effects: none
+ */
+int32_t text_get(uint32_t inode, uint32_t length) {
+    uint32_t pages = (length + FOURKB - 1) / FOURKB;
+    int32_t slot, free_slot = -1;
+
+    for(slot = 0; slot < TEXT_CACHE_FILES; slot++) {
+        if(text_files[slot].users == 0) {
+            if(free_slot == -1) {
+                free_slot = slot;
+            }
+        } else if(text_files[slot].inode == inode && text_files[slot].pages == pages) {
+            text_files[slot].users++;
+            return slot;
+        }
+    }
+    if(free_slot == -1 || pages == 0) {
+        return -1;
+    }
+    text_files[free_slot].frames = kmalloc(pages * sizeof(uint32_t));
+    if(text_files[free_slot].frames == NULL) {
+        return -1;
+    }
+    memset(text_files[free_slot].frames, 0, pages * sizeof(uint32_t));
+    text_files[free_slot].inode = inode;
+    text_files[free_slot].pages = pages;
+    text_files[free_slot].users = 1;
+    return free_slot;
+}
+
+/* release_pages()
+ * Description: Drops the cache's reference to every page of a file read
+ *              in so far. Pages processes still map stay with them.
+ * Inputs: file - cached file
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+static void release_pages(text_file_t * file) {
+    uint32_t i;
+
+    for(i = 0; i < file->pages; i++) {
+        if(file->frames[i] != 0) {
+            free_frame(file->frames[i]);
+            file->frames[i] = 0;
+        }
+    }
+}
+
+/* text_put()
+ * Description: Unregisters a process running an executable, emptying the
+ *              slot when it was the last one.
+ * Inputs: slot - slot from text_get, -1 is ignored
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void text_put(int32_t slot) {
+    text_file_t * file;
+
+    if(slot < 0 || slot >= TEXT_CACHE_FILES || text_files[slot].users == 0) {
+        return;
+    }
+    file = &text_files[slot];
+    if(--file->users > 0) {
+        return;
+    }
+    release_pages(file);
+    kfree(file->frames);
+    memset(file, 0, sizeof(text_file_t));
+}
+
+/* text_frame()
+ * Description: Gives the frame holding a page of a cached executable,
+ *              reading it in the first time: the part of the file in the
+ *              page, zeros after its end.
+ * Inputs: slot - slot from text_get
+ *         page - page index in the file
+ * Outputs: none
+ * Returns: the frame with a reference taken for the caller's mapping, 0 if
+ *          the page is past the file or no frame is left
+ * Side Effects: Interrupts must be off, the page is read through the scratch window
+ */
+uint32_t text_frame(int32_t slot, uint32_t page) {
+    text_file_t * file;
+    uint32_t frame;
+
+    if(slot < 0 || slot >= TEXT_CACHE_FILES || page >= text_files[slot].pages) {
+        return 0;
+    }
+    file = &text_files[slot];
+    frame = file->frames[page];
+    if(frame != 0) {
+        text_hits++;
+    } else {
+        frame = alloc_zeroed_frame();
+        if(frame == 0) {
+            return 0;
+        }
+        Page_Table[SCRATCH_PTE] = frame | PRESENT | R_W;
+        tlb_invalidate(SCRATCH_ADDR);
+        read_data(file->inode, page * FOURKB, (uint8_t *) SCRATCH_ADDR, FOURKB);
+        Page_Table[SCRATCH_PTE] = R_W;
+        tlb_invalidate(SCRATCH_ADDR);
+        file->frames[page] = frame;
+        text_misses++;
+    }
+    share_frame(frame);
+    return frame;
+}
+
+/* text_stats()
+ * Description: Reports how much the text cache holds and how often it
+ *              saved reading a page.
+ * Inputs: files - filled with the number of cached executables
+ *         pages - filled with the number of pages read in for them
+ *         hits - filled with faults served from the cache
+ *         misses - filled with faults that read a page in
+ * Outputs: none
+ * Returns: none
+ * Side Effects: none
+ */
+void text_stats(uint32_t * files, uint32_t * pages, uint32_t * hits, uint32_t * misses) {
+    int32_t slot;
+    uint32_t i;
+
+    *files = 0;
+    *pages = 0;
+    for(slot = 0; slot < TEXT_CACHE_FILES; slot++) {
+        if(text_files[slot].users == 0) {
+            continue;
+        }
+        (*files)++;
+        for(i = 0; i < text_files[slot].pages; i++) {
+            if(text_files[slot].frames[i] != 0) {
+                (*pages)++;
+            }
+        }
+    }
+    *hits = text_hits;
+    *misses = text_misses;
+}
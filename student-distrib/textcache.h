@@ -0,0 +1,23 @@
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include "types.h"
+
+#define TEXT_CACHE_FILES 16     /* executables cached at once, more run with private pages */
+
+/* Pages of one executable, read in once and mapped copy-on-write into
+ * every process running it. The cache holds one reference to each frame,
+ * every mapping another. */
+typedef struct text_file_t {
+    uint32_t inode;
+    uint32_t users;     /* processes running the file, 0 while the slot is unused */
+    uint32_t pages;     /* pages the file spans                                   */
+    uint32_t * frames;  /* frame of every page, 0 until a process faults it in    */
+} text_file_t;
+
+int32_t text_get(uint32_t inode, uint32_t length);
+void text_put(int32_t slot);
+uint32_t text_frame(int32_t slot, uint32_t page);
+void text_stats(uint32_t * files, uint32_t * pages, uint32_t * hits, uint32_t * misses);
+
+#endif
@@ -5,6 +5,7 @@
 
 #define BUFSIZE 1024
 #define SBUFSIZE 33
+#define NUM_DIRENTS 16
 
 int32_t
 do_one_file (const char* s, const char* fname) 
@@ -67,9 +68,10 @@ do_one_file (const char* s, const char* fname)
 
 int main ()
 {
-    int32_t fd, cnt;
+    int32_t fd, cnt, i, len;
     uint8_t buf[SBUFSIZE];
     uint8_t search[BUFSIZE];
+    ece391_dirent_t dirents[NUM_DIRENTS];
 
     if (0 != ece391_getargs (search, BUFSIZE)) {
         ece391_fdputs (1, (uint8_t*)"could not read argument\n");
@@ -81,16 +83,21 @@ int main ()
 	return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    while (0 != (cnt = ece391_getdents (fd, dirents, sizeof (dirents)))) {
         if (-1 == cnt) {
 	    ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	    return 3;
 	}
-	if ('.' == buf[0]) /* a directory... */
-	    continue;
-	buf[cnt] = '\0';
-	if (0 != do_one_file ((char*)search, (char*)buf))
-	    return 3;
+	for (i = 0; i < cnt / (int32_t)sizeof (ece391_dirent_t); i++) {
+	    /* only regular files with data can match, skip the rest unopened */
+	    if (2 != dirents[i].type || 0 == dirents[i].length)
+	        continue;
+	    for (len = 0; len < SBUFSIZE - 1 && '\0' != dirents[i].name[len]; len++)
+	        buf[len] = dirents[i].name[len];
+	    buf[len] = '\0';
+	    if (0 != do_one_file ((char*)search, (char*)buf))
+	        return 3;
+	}
     }
 
     return 0;
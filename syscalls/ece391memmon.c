@@ -0,0 +1,43 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define RTC_FREQ 2      /* ticks per second */
+
+/* Prints the kernel's memstat report, then again once a second for as
+ * many more times as the argument says (memmon 10). */
+int main ()
+{
+    int32_t fd, rtc_fd, cnt, freq = RTC_FREQ, garbage;
+    uint32_t polls = 0, i, tick;
+    uint8_t buf[1024];
+
+    if (0 == ece391_getargs (buf, 1024)) {
+        for (i = 0; buf[i] >= '0' && buf[i] <= '9'; i++)
+            polls = polls * 10 + buf[i] - '0';
+    }
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"memstat")) ||
+        -1 == (rtc_fd = ece391_open ((uint8_t*)"rtc")) ||
+        -1 == ece391_write (rtc_fd, &freq, 4)) {
+        ece391_fdputs (1, (uint8_t*)"could not open memstat\n");
+        return 2;
+    }
+
+    for (i = 0; i <= polls; i++) {
+        if (i > 0) {
+            for (tick = 0; tick < RTC_FREQ; tick++)
+                ece391_read (rtc_fd, &garbage, 4);
+            ece391_fdputs (1, (uint8_t*)"\n");
+        }
+        /* a read from position 0 takes a new report */
+        ece391_lseek (fd, 0, SEEK_SET);
+        while (0 != (cnt = ece391_read (fd, buf, 1024))) {
+            if (-1 == cnt || -1 == ece391_write (1, buf, cnt))
+                return 3;
+        }
+    }
+
+    return 0;
+}
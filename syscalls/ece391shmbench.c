@@ -0,0 +1,153 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SHM_KEY     0x53484D42          /* "SHMB" */
+#define CHUNK       (256 * 1024)        /* bytes handed over per round */
+#define ROUNDS      32
+#define WORDS       (CHUNK / 4)
+#define HEADER      1024                /* words before the data, one page */
+#define SEG_SIZE    (HEADER * 4 + 2 * CHUNK)
+
+/* header words the two processes hand buffers over with */
+#define SEQ         0                   /* last buffer the producer filled   */
+#define ACK         1                   /* last buffer the consumer finished */
+#define SUM         2                   /* consumer's running checksum       */
+
+/* stores to the data must land before the store to SEQ or ACK that publishes them */
+#define BARRIER()   asm volatile ("" : : : "memory")
+
+/* A pipe copies every buffer twice: from the producer into the pipe and
+ * from the pipe into the consumer. The staging half of the segment stands
+ * in for the pipe, the private buffers for the two ends. */
+static uint32_t producer_buf[WORDS];
+static uint32_t consumer_buf[WORDS];
+
+static inline uint32_t cycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return lo;
+}
+
+static void produce (uint32_t* buf, uint32_t round)
+{
+    uint32_t i;
+    for (i = 0; i < WORDS; i++)
+        buf[i] = round + i;
+}
+
+static uint32_t consume (const uint32_t* buf)
+{
+    uint32_t i, sum = 0;
+    for (i = 0; i < WORDS; i++)
+        sum += buf[i];
+    return sum;
+}
+
+static void copy (uint32_t* dst, const uint32_t* src)
+{
+    uint32_t i;
+    for (i = 0; i < WORDS; i++)
+        dst[i] = src[i];
+}
+
+static void report (const char* what, uint32_t total)
+{
+    uint8_t buf[16];
+
+    ece391_fdputs (1, (uint8_t*)what);
+    ece391_fdputs (1, ece391_itoa (total / (CHUNK / 1024 * ROUNDS), buf, 10));
+    ece391_fdputs (1, (uint8_t*)" cycles per KB\n");
+}
+
+/* The forked child: takes every buffer the parent hands over, first out of
+ * the staging area through its own buffer, then in place, and acks it. */
+static int32_t consumer (volatile uint32_t* seg)
+{
+    uint32_t* data = (uint32_t*)(seg + HEADER);
+    uint32_t* staging = data + WORDS;
+    uint32_t seq, sum = 0;
+
+    for (seq = 1; seq <= 2 * ROUNDS; seq++) {
+        while (seq != seg[SEQ]);
+        BARRIER ();
+        if (seq <= ROUNDS) {
+            copy (consumer_buf, staging);
+            sum += consume (consumer_buf);
+        } else {
+            sum += consume (data);
+        }
+        seg[SUM] = sum;
+        BARRIER ();
+        seg[ACK] = seq;
+    }
+    return 0;
+}
+
+/* Hands a filled buffer to the consumer and waits until it is done with it. */
+static void hand_over (volatile uint32_t* seg, uint32_t seq)
+{
+    BARRIER ();
+    seg[SEQ] = seq;
+    while (seq != seg[ACK]);
+    BARRIER ();
+}
+
+int main ()
+{
+    volatile uint32_t* seg;
+    uint32_t* data;
+    uint32_t* staging;
+    uint32_t round, seq = 0, start, piped, shared, sum = 0;
+    int32_t id, child;
+
+    if (-1 == (id = ece391_shm_create (SHM_KEY, SEG_SIZE)) ||
+        -1 == (int32_t)(seg = (volatile uint32_t*)ece391_shm_attach (id))) {
+        ece391_fdputs (1, (uint8_t*)"can't attach the shared segment\n");
+        return 2;
+    }
+    data = (uint32_t*)(seg + HEADER);
+    staging = data + WORDS;
+
+    /* a forked child keeps the segment attached and consumes what we produce */
+    seg[SEQ] = 0;
+    seg[ACK] = 0;
+    seg[SUM] = 0;
+    if (-1 == (child = ece391_fork ())) {
+        ece391_fdputs (1, (uint8_t*)"fork failed\n");
+        return 3;
+    }
+    if (0 == child)
+        return consumer (seg);
+
+    /* round trips include waiting for the scheduler to run the other side */
+    start = cycles ();
+    for (round = 0; round < ROUNDS; round++) {
+        produce (producer_buf, round);
+        copy (staging, producer_buf);
+        hand_over (seg, ++seq);
+    }
+    piped = cycles () - start;
+
+    start = cycles ();
+    for (round = 0; round < ROUNDS; round++) {
+        produce (data, round);
+        hand_over (seg, ++seq);
+    }
+    shared = cycles () - start;
+
+    for (round = 0; round < ROUNDS; round++) {
+        produce (producer_buf, round);
+        sum += 2 * consume (producer_buf);
+    }
+    if (sum != seg[SUM]) {
+        ece391_fdputs (1, (uint8_t*)"checksums differ\n");
+        return 1;
+    }
+    report ("pipe-style copy: ", piped);
+    report ("shared memory:   ", shared);
+    ece391_shm_detach ((void*)seg);
+    return 0;
+}
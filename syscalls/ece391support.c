@@ -3,6 +3,17 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
+/* ece391_malloc hands out power of two blocks from 16 bytes up, each with
+ * an 8 byte header holding its size class, and keeps one free list per
+ * class. Classes smaller than a page are carved out of page sized chunks
+ * of the heap, so most calls never reach ece391_sbrk. */
+#define MALLOC_MIN     16
+#define MALLOC_CLASSES 18       /* 16 bytes to 2 MB */
+#define MALLOC_HEADER  8        /* keeps every block 8 byte aligned */
+#define MALLOC_CHUNK   4096
+
+static uint8_t *malloc_free[MALLOC_CLASSES];
+
 uint32_t ece391_strlen(const uint8_t* s)
 {
     uint32_t len;
@@ -102,3 +113,62 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+/* Smallest size class that holds size bytes plus the header, -1 if none does */
+static int32_t malloc_class(uint32_t size)
+{
+    int32_t cls;
+
+    for (cls = 0; cls < MALLOC_CLASSES; cls++) {
+        if (size <= (MALLOC_MIN << cls) - MALLOC_HEADER)
+            return cls;
+    }
+    return -1;
+}
+
+/* Fill a size class's free list with a new chunk of heap */
+static int32_t malloc_refill(int32_t cls)
+{
+    uint32_t block = MALLOC_MIN << cls;
+    uint32_t chunk = (block < MALLOC_CHUNK) ? MALLOC_CHUNK : block;
+    uint32_t off;
+    int32_t mem;
+
+    mem = ece391_sbrk(chunk);
+    if (-1 == mem)
+        return -1;
+    for (off = chunk; off > 0; off -= block) {
+        *(uint8_t **)(mem + off - block) = malloc_free[cls];
+        malloc_free[cls] = (uint8_t *)(mem + off - block);
+    }
+    return 0;
+}
+
+/* Allocate size bytes, 8 byte aligned. Returns 0 if the heap is full. */
+void *ece391_malloc(uint32_t size)
+{
+    int32_t cls = malloc_class(size);
+    uint8_t *block;
+
+    if (0 == size || -1 == cls)
+        return 0;
+    if (0 == malloc_free[cls] && -1 == malloc_refill(cls))
+        return 0;
+    block = malloc_free[cls];
+    malloc_free[cls] = *(uint8_t **)block;
+    *(uint32_t *)block = cls;
+    return block + MALLOC_HEADER;
+}
+
+/* Give a block from ece391_malloc back to its size class */
+void ece391_free(void* ptr)
+{
+    uint8_t *block;
+    uint32_t cls;
+
+    if (0 == ptr)
+        return;
+    block = (uint8_t *)ptr - MALLOC_HEADER;
+    cls = *(uint32_t *)block;
+    *(uint8_t **)block = malloc_free[cls];
+    malloc_free[cls] = block;
+}
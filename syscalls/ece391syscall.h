@@ -5,6 +5,13 @@
 
 /* All calls return >= 0 on success or -1 on failure. */
 
+/* One directory entry as filled in by ece391_getdents. */
+typedef struct ece391_dirent {
+    uint8_t name[32];   /* not NUL terminated if the name uses all 32 characters */
+    uint32_t type;      /* 0 = rtc, 1 = directory, 2 = regular file */
+    uint32_t length;    /* file size in bytes */
+} ece391_dirent_t;
+
 /*  
  * Note that the system call for halt will have to make sure that only
  * the low byte of EBX (the status argument) is returned to the calling
@@ -21,6 +28,46 @@ extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+extern int32_t ece391_getdents (int32_t fd, ece391_dirent_t* buf, int32_t nbytes);
+extern int32_t ece391_lseek (int32_t fd, int32_t offset, int32_t whence);
+extern int32_t ece391_pread (int32_t fd, void* buf, int32_t nbytes, int32_t offset);
+/* Returns the child's pid in the parent and 0 in the child. */
+extern int32_t ece391_fork (void);
+/* Grows the heap by increment bytes (shrinks it if negative) and returns
+ * the old end of the heap, the start of the new memory. */
+extern int32_t ece391_sbrk (int32_t increment);
+/* Shared memory: shm_create returns the id of the segment named key (made
+ * zero filled if it doesn't exist yet), shm_attach maps it and returns its
+ * address, shm_detach unmaps it again. Processes that attach the same id
+ * see the same bytes, and fork keeps a parent's segments attached. */
+extern int32_t ece391_shm_create (uint32_t key, uint32_t size);
+extern int32_t ece391_shm_attach (int32_t id);
+extern int32_t ece391_shm_detach (void* addr);
+/* Maps zero filled memory (MAP_ANONYMOUS) or length bytes of the open file
+ * fd from offset, which must be page aligned, and returns its address or
+ * MAP_FAILED. File mappings are read-only. Pages are read in or zeroed the
+ * first time they are touched. addr is only a hint, pass 0 to let the
+ * kernel choose. */
+extern void* ece391_mmap (void* addr, uint32_t length, int32_t prot, int32_t flags, int32_t fd, int32_t offset);
+extern int32_t ece391_munmap (void* addr, uint32_t length);
+/* Adds an empty file named filename, which open can then open for writing.
+ * Fails if the name is already taken. */
+extern int32_t ece391_create (const uint8_t* filename);
+
+/* prot and flags values for ece391_mmap */
+#define PROT_READ       0x1
+#define PROT_WRITE      0x2
+#define MAP_SHARED      0x1
+#define MAP_PRIVATE     0x2
+#define MAP_ANONYMOUS   0x20
+#define MAP_FAILED      ((void*)-1)
+
+/* whence values for ece391_lseek */
+enum seek_whence {
+	SEEK_SET = 0,
+	SEEK_CUR,
+	SEEK_END
+};
 
 enum signums {
 	DIV_ZERO = 0,
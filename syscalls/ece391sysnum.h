@@ -11,5 +11,16 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_GETDENTS  11
+#define SYS_LSEEK  12
+#define SYS_PREAD  13
+#define SYS_FORK  14
+#define SYS_SBRK  15
+#define SYS_SHM_CREATE  16
+#define SYS_SHM_ATTACH  17
+#define SYS_SHM_DETACH  18
+#define SYS_MMAP  19
+#define SYS_MUNMAP  20
+#define SYS_CREATE  21
 
 #endif /* ECE391SYSNUM_H */
@@ -0,0 +1,159 @@
+/* lz4.c - greedy LZ4 block compressor and the chunked file packer
+ * Produces the raw LZ4 block format (no frame), which lz4_decompress in
+ * student-distrib/lz4.c decodes. Compression ratio matters less than
+ * simplicity here: one hash table of 4 byte sequences, first match wins.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "lz4.h"
+
+/* read32()
+ * Description: Loads 4 bytes without caring about alignment.
+ * Inputs: p - bytes to load
+ * Returns: the bytes as a 32 bit value
+ */
+static uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* hash4()
+ * Description: Multiplicative hash of 4 bytes into LZ4_HASH_BITS bits.
+ * Inputs: v - the bytes
+ * Returns: slot in the match table
+ */
+static uint32_t hash4(uint32_t v) {
+    return (v * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+/* put_length()
+ * Description: Writes the continuation bytes of a length that didn't fit its
+ *              4 bit token field (len is what is left after subtracting 15).
+ * Inputs: op - where to write
+ *         len - remaining length
+ * Returns: position after the bytes written
+ */
+static uint8_t *put_length(uint8_t *op, uint32_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+/* put_sequence()
+ * Description: Emits one sequence: token, literals and, unless this is the
+ *              final literals-only sequence, a match.
+ * Inputs: op - output position
+ *         oend - end of the output buffer
+ *         lit - first literal
+ *         lit_len - number of literals
+ *         offset - match distance, 0 for the final sequence
+ *         match_len - match length, at least LZ4_MIN_MATCH
+ * Returns: position after the sequence, NULL if it doesn't fit
+ */
+static uint8_t *put_sequence(uint8_t *op, uint8_t *oend, const uint8_t *lit, uint32_t lit_len,
+                             uint32_t offset, uint32_t match_len) {
+    uint8_t *token = op++;
+    /* worst case size of what follows the token */
+    if (op + lit_len + lit_len / 255 + 1 + 2 + match_len / 255 + 1 > oend) {
+        return NULL;
+    }
+    if (lit_len >= 15) {
+        *token = 15 << 4;
+        op = put_length(op, lit_len - 15);
+    } else {
+        *token = lit_len << 4;
+    }
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+    if (offset == 0) {
+        return op;
+    }
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    match_len -= LZ4_MIN_MATCH;
+    if (match_len >= 15) {
+        *token |= 15;
+        op = put_length(op, match_len - 15);
+    } else {
+        *token |= match_len;
+    }
+    return op;
+}
+
+/* lz4_compress()
+ * Description: Compresses src into one LZ4 block.
+ * Inputs: src - data to compress
+ *         src_len - size of src
+ *         dst - output buffer
+ *         dst_cap - size of dst
+ * Returns: size of the block, -1 if it doesn't fit in dst_cap
+ */
+int lz4_compress(const uint8_t *src, int src_len, uint8_t *dst, int dst_cap) {
+    uint32_t table[1 << LZ4_HASH_BITS];  /* position + 1 of the last sequence with each hash, 0 if none */
+    const uint8_t *ip = src, *anchor = src;
+    const uint8_t *mflimit = src + src_len - LZ4_MF_LIMIT;
+    const uint8_t *matchlimit = src + src_len - LZ4_LAST_LITERALS;
+    uint8_t *op = dst, *oend = dst + dst_cap;
+    uint32_t h, len;
+    const uint8_t *ref;
+
+    memset(table, 0, sizeof(table));
+    while (src_len > LZ4_MF_LIMIT && ip < mflimit) {
+        h = hash4(read32(ip));
+        ref = src + table[h] - 1;
+        table[h] = ip - src + 1;
+        if (ref < src || ip - ref > LZ4_MAX_OFFSET || read32(ref) != read32(ip)) {
+            ip++;
+            continue;
+        }
+        for (len = LZ4_MIN_MATCH; ip + len < matchlimit && ref[len] == ip[len]; len++);
+        op = put_sequence(op, oend, anchor, ip - anchor, ip - ref, len);
+        if (op == NULL) {
+            return -1;
+        }
+        ip += len;
+        anchor = ip;
+    }
+    op = put_sequence(op, oend, anchor, src + src_len - anchor, 0, 0);
+    return op == NULL ? -1 : op - dst;
+}
+
+/* lz4_pack()
+ * Description: Compresses a file into the chunked stream read_lz4 expects:
+ *              an offset table, then one LZ4 block per LZ4_CHUNK chunk,
+ *              stored raw when compressing doesn't make it shorter.
+ * Inputs: data - file contents
+ *         len - file length
+ *         out_len - filled with the stream length
+ * Returns: the stream, malloc'd, NULL if a chunk fails to round trip
+ */
+uint8_t *lz4_pack(const uint8_t *data, uint32_t len, uint32_t *out_len) {
+    uint32_t chunks = (len + LZ4_CHUNK - 1) / LZ4_CHUNK, i, size, pos;
+    uint8_t *stream = malloc((chunks + 1) * sizeof(uint32_t) + (size_t)chunks * LZ4_CHUNK);
+    uint32_t *table = (uint32_t *)stream;
+    uint8_t check[LZ4_CHUNK];
+    int n;
+
+    pos = (chunks + 1) * sizeof(uint32_t);
+    for (i = 0; i < chunks; i++) {
+        size = (len - i * LZ4_CHUNK < LZ4_CHUNK) ? len - i * LZ4_CHUNK : LZ4_CHUNK;
+        table[i] = pos;
+        n = lz4_compress(data + i * LZ4_CHUNK, size, stream + pos, size - 1);
+        if (n < 0) {
+            memcpy(stream + pos, data + i * LZ4_CHUNK, size);
+            n = size;
+        } else if (lz4_decompress(stream + pos, n, check, size) != (int)size ||
+                   memcmp(check, data + i * LZ4_CHUNK, size) != 0) {
+            free(stream);
+            return NULL;
+        }
+        pos += n;
+    }
+    table[chunks] = pos;
+    *out_len = pos;
+    return stream;
+}
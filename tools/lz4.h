@@ -0,0 +1,20 @@
+/* lz4.h - host side LZ4 block compressor used by the image tools
+ * The decompressor is the kernel's own, built from student-distrib/lz4.c
+ */
+#ifndef TOOLS_LZ4_H
+#define TOOLS_LZ4_H
+
+#include <stdint.h>
+
+#define LZ4_MIN_MATCH 4      /* shortest match the format can express               */
+#define LZ4_LAST_LITERALS 5  /* the last 5 bytes of a block are always literals     */
+#define LZ4_MF_LIMIT 12      /* no match may start in the last 12 bytes of a block  */
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_BITS 12
+#define LZ4_CHUNK 4096     /* files are compressed in chunks of one filesystem block */
+
+int lz4_compress(const uint8_t *src, int src_len, uint8_t *dst, int dst_cap);
+uint8_t *lz4_pack(const uint8_t *data, uint32_t len, uint32_t *out_len);
+int lz4_decompress(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_len);
+
+#endif
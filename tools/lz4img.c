@@ -0,0 +1,191 @@
+/* lz4img.c - repack an sOS filesystem image with LZ4 compressed files
+ *
+ * usage: lz4img [-x] [-k] in.img out.img [name ...]
+ *   -x    leave ELF executables raw so execute can still map them out of the image
+ *   -k    also keep a raw copy of every compressed file as <name>.raw, for
+ *         comparing the two read paths (see bench_read_lz4 in tests.c)
+ *   name  compress only these files, by default every regular file that shrinks
+ *
+ * build: gcc -O2 -o lz4img lz4img.c lz4.c ../student-distrib/lz4.c
+ *
+ * Reads images in the original createfs layout. Data blocks are rewritten
+ * one file after another, so every file ends up contiguous, and compressed
+ * files are laid out as described above DENTRY_LZ4 in filesystem.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lz4.h"
+#include "sosfs.h"
+
+#define ELF_MAGIC "\177ELF"
+
+static uint8_t *out_data;       /* data blocks of the new image */
+static uint32_t out_blocks;     /* data blocks used so far      */
+
+/* die()
+ * Description: Prints an error and exits.
+ * Inputs: msg - what went wrong
+ */
+static void die(const char *msg) {
+    fprintf(stderr, "lz4img: %s\n", msg);
+    exit(1);
+}
+
+/* put_file()
+ * Description: Appends stored bytes to the new image's data blocks and
+ *              points an inode at them.
+ * Inputs: ino - inode to fill, its length is set by the caller
+ *         bytes - stored bytes
+ *         len - number of stored bytes
+ */
+static void put_file(inode *ino, const uint8_t *bytes, uint32_t len) {
+    uint32_t i, n = (len + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (n > NUM_DATA_BLOCKS) {
+        die("file too large for the original image layout");
+    }
+    out_data = realloc(out_data, (size_t)(out_blocks + n) * BLOCK_SIZE);
+    memset(out_data + (size_t)out_blocks * BLOCK_SIZE, 0, (size_t)n * BLOCK_SIZE);
+    memcpy(out_data + (size_t)out_blocks * BLOCK_SIZE, bytes, len);
+    for (i = 0; i < n; i++) {
+        ino->data_block[i] = out_blocks++;
+    }
+}
+
+/* wanted()
+ * Description: Checks whether a file was named on the command line.
+ * Inputs: name - file name, NUL padded to NAME_LEN
+ *         names - names from the command line
+ *         count - number of names, 0 means every file
+ * Returns: nonzero if the file should be compressed
+ */
+static int wanted(const char *name, char **names, int count) {
+    int i;
+    if (count == 0) {
+        return 1;
+    }
+    for (i = 0; i < count; i++) {
+        if (strncmp(name, names[i], NAME_LEN) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int skip_elf = 0, keep_raw = 0, arg = 1;
+    uint32_t i, len, stored, raw_total = 0, packed_total = 0, packed = 0;
+    while (arg < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-x") == 0) {
+            skip_elf = 1;
+        } else if (strcmp(argv[arg], "-k") == 0) {
+            keep_raw = 1;
+        } else {
+            die("usage: lz4img [-x] [-k] in.img out.img [name ...]");
+        }
+        arg++;
+    }
+    if (argc - arg < 2) {
+        die("usage: lz4img [-x] [-k] in.img out.img [name ...]");
+    }
+
+    FILE *f = fopen(argv[arg], "rb");
+    if (f == NULL) {
+        die("cannot open input image");
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *img = malloc(size);
+    if (fread(img, 1, size, f) != (size_t)size) {
+        die("cannot read input image");
+    }
+    fclose(f);
+
+    boot_block *in_boot = (boot_block *)img;
+    if (in_boot->magic == FS_V2_MAGIC) {
+        die("extended (v2) images are not supported");
+    }
+    inode *in_inodes = (inode *)(img + BLOCK_SIZE);
+    uint8_t *in_data = img + (size_t)(1 + in_boot->num_inodes) * BLOCK_SIZE;
+
+    boot_block out_boot = *in_boot;
+    inode *out_inodes = calloc(in_boot->num_inodes, sizeof(inode));
+    uint8_t *file = malloc((size_t)NUM_DATA_BLOCKS * BLOCK_SIZE);
+    uint32_t next_inode = 0;   /* for -k copies, first inode no file uses */
+    uint8_t *used = calloc(in_boot->num_inodes, 1);
+    for (i = 0; i < in_boot->num_entries; i++) {
+        if (in_boot->entries[i].type == FILE_TYPE) {
+            used[in_boot->entries[i].inode] = 1;
+        }
+    }
+
+    /* only the original entries, -k copies are appended behind them */
+    for (i = 0; i < in_boot->num_entries; i++) {
+        dentry *d = &out_boot.entries[i];
+        if (d->type != FILE_TYPE) {
+            continue;
+        }
+        inode *src = &in_inodes[d->inode];
+        inode *dst = &out_inodes[d->inode];
+        uint32_t b;
+        len = src->length;
+        for (b = 0; b * BLOCK_SIZE < len; b++) {
+            memcpy(file + b * BLOCK_SIZE, in_data + (size_t)src->data_block[b] * BLOCK_SIZE, BLOCK_SIZE);
+        }
+        dst->length = len;
+        raw_total += len;
+
+        int is_elf = len >= 4 && memcmp(file, ELF_MAGIC, 4) == 0;
+        uint8_t *stream = NULL;
+        if (wanted(d->name, argv + arg + 2, argc - arg - 2) && !(skip_elf && is_elf)) {
+            stream = lz4_pack(file, len, &stored);
+            /* not worth it unless it saves a block */
+            if (stream != NULL && (stored + BLOCK_SIZE - 1) / BLOCK_SIZE >= (len + BLOCK_SIZE - 1) / BLOCK_SIZE) {
+                free(stream);
+                stream = NULL;
+            }
+        }
+        if (stream == NULL) {
+            put_file(dst, file, len);
+            packed_total += len;
+            continue;
+        }
+        printf("%-32.32s %8u -> %8u\n", d->name, len, stored);
+        d->flags |= DENTRY_LZ4;
+        put_file(dst, stream, stored);
+        packed_total += stored;
+        packed++;
+        free(stream);
+
+        if (keep_raw) {
+            while (next_inode < in_boot->num_inodes && used[next_inode]) {
+                next_inode++;
+            }
+            if (next_inode == in_boot->num_inodes || out_boot.num_entries == NUM_DENTRIES) {
+                die("no room for the raw copy");
+            }
+            used[next_inode] = 1;
+            dentry *copy = &out_boot.entries[out_boot.num_entries++];
+            *copy = *d;
+            copy->flags &= ~DENTRY_LZ4;
+            copy->inode = next_inode;
+            snprintf(copy->name, NAME_LEN, "%.27s.raw", d->name);
+            out_inodes[next_inode].length = len;
+            put_file(&out_inodes[next_inode], file, len);
+        }
+    }
+    out_boot.num_blocks = out_blocks;
+
+    f = fopen(argv[arg + 1], "wb");
+    if (f == NULL) {
+        die("cannot create output image");
+    }
+    fwrite(&out_boot, 1, sizeof(out_boot), f);
+    fwrite(out_inodes, sizeof(inode), in_boot->num_inodes, f);
+    fwrite(out_data, BLOCK_SIZE, out_blocks, f);
+    fclose(f);
+    printf("%u files compressed, %u -> %u bytes of file data, image %ld -> %u bytes\n", packed, raw_total,
+           packed_total, size, (1 + in_boot->num_inodes + out_blocks) * BLOCK_SIZE);
+    return 0;
+}
@@ -0,0 +1,546 @@
+/* mkfs.c - build an sOS filesystem image from a directory, or report on one
+ *
+ * usage: mkfs [-s | -f order.txt] [-z] [-2] [-i inodes] [-q] [-v] dir out.img
+ *        mkfs -a [-v] image
+ *   -s    sort directory entries by name, so the table can be binary searched
+ *   -f    order directory entries by expected access frequency: order.txt
+ *         lists names one per line, most used first; files it doesn't list
+ *         follow in the default order
+ *   -z    LZ4 compress every file that isn't an executable, when that saves a block
+ *   -2    write the extended (v2) format even if the original one would do;
+ *         it is picked automatically for more than 63 entries or files
+ *         over 1023 blocks
+ *   -i    number of inodes, by default 64 or one per file if that is more
+ *   -q    don't print the report
+ *   -v    list every file in the report
+ *   -a    don't build anything, just report on an existing image
+ *
+ * build: gcc -O2 -o mkfs mkfs.c lz4.c ../student-distrib/lz4.c
+ *
+ * By default the directory holds ".", "rtc", then executables and then the
+ * other files, each group in name order. Whatever the directory order, data
+ * is laid out executables first, one contiguous run of blocks per file, so
+ * every block is page aligned (the module is) and execute can map programs
+ * straight out of the image. Indirect blocks follow the run they describe
+ * and v2 directory blocks go after all file data.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "lz4.h"
+#include "sosfs.h"
+
+#define ELF_MAGIC "\177ELF"
+#define DEFAULT_INODES 64
+#define LINE_LEN 256
+
+typedef struct file_t {
+    char name[NAME_LEN + 1];
+    uint32_t type;
+    uint8_t *data;         /* contents as read from the directory           */
+    uint32_t length;
+    uint8_t *stored;       /* what goes in the data blocks, data or LZ4     */
+    uint32_t stored_len;
+    uint32_t lz4;
+    uint32_t elf;
+    uint32_t rank;         /* position in the -f list, or past its end      */
+    uint32_t inode;
+} file_t;
+
+static file_t *files;
+static uint32_t num_files;
+static uint8_t *blocks;        /* data blocks of the new image  */
+static uint32_t num_blocks;
+
+/* die()
+ * Description: Prints an error and exits.
+ * Inputs: msg - what went wrong
+ *         arg - name the error is about, may be NULL
+ */
+static void die(const char *msg, const char *arg) {
+    fprintf(stderr, "mkfs: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+    exit(1);
+}
+
+/* new_block()
+ * Description: Appends a zeroed data block to the new image.
+ * Returns: number of the block
+ */
+static uint32_t new_block(void) {
+    blocks = realloc(blocks, (size_t)(num_blocks + 1) * BLOCK_SIZE);
+    memset(blocks + (size_t)num_blocks * BLOCK_SIZE, 0, BLOCK_SIZE);
+    return num_blocks++;
+}
+
+/* block_ptrs()
+ * Description: Views a data block of the new image as block numbers.
+ * Inputs: block - data block number
+ * Returns: the block's contents as an array of PTRS_PER_BLOCK entries
+ */
+static uint32_t *block_ptrs(uint32_t block) {
+    return (uint32_t *)(blocks + (size_t)block * BLOCK_SIZE);
+}
+
+/* add_file()
+ * Description: Reads one file of the source directory.
+ * Inputs: dir - source directory
+ *         name - file name inside it
+ */
+static void add_file(const char *dir, const char *name) {
+    char path[LINE_LEN * 2];
+    struct stat st;
+    FILE *f;
+    file_t *file;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return;
+    }
+    if (strlen(name) > NAME_LEN) {
+        fprintf(stderr, "mkfs: %s is longer than %d characters, truncated\n", name, NAME_LEN);
+    }
+    files = realloc(files, (num_files + 1) * sizeof(file_t));
+    file = &files[num_files++];
+    memset(file, 0, sizeof(file_t));
+    snprintf(file->name, sizeof(file->name), "%.32s", name);
+    file->type = FILE_TYPE;
+    file->length = st.st_size;
+    file->data = malloc(st.st_size + 1);
+    f = fopen(path, "rb");
+    if (f == NULL || fread(file->data, 1, st.st_size, f) != (size_t)st.st_size) {
+        die("cannot read", path);
+    }
+    fclose(f);
+    file->elf = file->length >= 4 && memcmp(file->data, ELF_MAGIC, 4) == 0;
+    file->stored = file->data;
+    file->stored_len = file->length;
+}
+
+/* add_special()
+ * Description: Adds a directory entry that has no data, like "." and "rtc".
+ * Inputs: name - entry name
+ *         type - DIR_TYPE or RTC_TYPE
+ */
+static void add_special(const char *name, uint32_t type) {
+    files = realloc(files, (num_files + 1) * sizeof(file_t));
+    memset(&files[num_files], 0, sizeof(file_t));
+    strncpy(files[num_files].name, name, NAME_LEN);
+    files[num_files].type = type;
+    num_files++;
+}
+
+/* sort_group()
+ * Description: Rank of a file in the default order: "." first, then
+ *              "rtc", then executables, then other files.
+ */
+static int sort_group(const file_t *f) {
+    if (f->type == DIR_TYPE) {
+        return 0;
+    }
+    if (f->type != FILE_TYPE) {
+        return 1;
+    }
+    return f->elf ? 2 : 3;
+}
+
+/* by_default_order()
+ * Description: qsort order: ".", "rtc", executables, other files, each by name.
+ */
+static int by_default_order(const void *a, const void *b) {
+    const file_t *x = a, *y = b;
+    int gx = sort_group(x);
+    int gy = sort_group(y);
+    if (gx != gy) {
+        return gx - gy;
+    }
+    return strncmp(x->name, y->name, NAME_LEN);
+}
+
+/* by_name()
+ * Description: qsort order: plain name order, what a binary search expects.
+ */
+static int by_name(const void *a, const void *b) {
+    return strncmp(((const file_t *)a)->name, ((const file_t *)b)->name, NAME_LEN);
+}
+
+/* by_rank()
+ * Description: qsort order: -f list position, then the default order.
+ */
+static int by_rank(const void *a, const void *b) {
+    const file_t *x = a, *y = b;
+    if (x->rank != y->rank) {
+        return x->rank < y->rank ? -1 : 1;
+    }
+    return by_default_order(a, b);
+}
+
+/* read_order()
+ * Description: Ranks files by their position in a -f list.
+ * Inputs: path - the list, one name per line
+ */
+static void read_order(const char *path) {
+    char line[LINE_LEN];
+    uint32_t rank = 0, i;
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        die("cannot open", path);
+    }
+    for (i = 0; i < num_files; i++) {
+        files[i].rank = (uint32_t)-1;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        for (i = 0; i < num_files; i++) {
+            if (strncmp(files[i].name, line, NAME_LEN) == 0 && files[i].rank == (uint32_t)-1) {
+                files[i].rank = rank++;
+            }
+        }
+    }
+    fclose(f);
+}
+
+/* place_file()
+ * Description: Writes a file's stored bytes as one run of new blocks and
+ *              fills its inode, adding indirect blocks after the run when
+ *              the file needs them.
+ * Inputs: file - file to place
+ *         ino - its inode
+ *         v2 - nonzero for the extended format
+ */
+static void place_file(const file_t *file, inode *ino, int v2) {
+    uint32_t n = (file->stored_len + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t direct = v2 ? NUM_DIRECT_V2 : NUM_DATA_BLOCKS;
+    uint32_t first = num_blocks, i, j, top;
+
+    for (i = 0; i < n; i++) {
+        new_block();
+    }
+    memcpy(blocks + (size_t)first * BLOCK_SIZE, file->stored, file->stored_len);
+    ino->length = file->length;
+    for (i = 0; i < n && i < direct; i++) {
+        ino->data_block[i] = first + i;
+    }
+    if (n <= direct) {
+        return;
+    }
+    ino->data_block[SINGLE_INDIRECT] = new_block();
+    for (i = direct; i < n && i < direct + PTRS_PER_BLOCK; i++) {
+        block_ptrs(ino->data_block[SINGLE_INDIRECT])[i - direct] = first + i;
+    }
+    if (n <= direct + PTRS_PER_BLOCK) {
+        return;
+    }
+    top = new_block();
+    ino->data_block[DOUBLE_INDIRECT] = top;
+    for (j = 0; i < n; j++) {
+        uint32_t second = new_block();
+        block_ptrs(top)[j] = second;
+        for (; i < n && i < direct + PTRS_PER_BLOCK * (j + 2); i++) {
+            block_ptrs(second)[i - direct - PTRS_PER_BLOCK * (j + 1)] = first + i;
+        }
+    }
+}
+
+/* image_block()
+ * Description: Finds a data block number of a file in an existing image.
+ * Inputs: img - the image
+ *         ino - the file's inode
+ *         block - index of the block within the file
+ *         v2 - nonzero for the extended format
+ * Returns: data block number
+ */
+static uint32_t image_block(const uint8_t *img, const inode *ino, uint32_t block, int v2) {
+    const boot_block *boot = (const boot_block *)img;
+    const uint32_t *ptrs;
+    const uint8_t *data = img + (size_t)(1 + boot->num_inodes) * BLOCK_SIZE;
+    if (!v2 || block < NUM_DIRECT_V2) {
+        return ino->data_block[block];
+    }
+    block -= NUM_DIRECT_V2;
+    if (block < PTRS_PER_BLOCK) {
+        return ((const uint32_t *)(data + (size_t)ino->data_block[SINGLE_INDIRECT] * BLOCK_SIZE))[block];
+    }
+    block -= PTRS_PER_BLOCK;
+    ptrs = (const uint32_t *)(data + (size_t)ino->data_block[DOUBLE_INDIRECT] * BLOCK_SIZE);
+    return ((const uint32_t *)(data + (size_t)ptrs[block / PTRS_PER_BLOCK] * BLOCK_SIZE))[block % PTRS_PER_BLOCK];
+}
+
+/* report()
+ * Description: Prints how well an image is laid out: directory order, block
+ *              use, slack in partially filled blocks, how fragmented files
+ *              are and whether executables can be mapped straight out of it.
+ *              One "key: values" line per topic so builds can track it.
+ * Inputs: img - the image
+ *         size - size of the image in bytes
+ *         name - image name for the first line
+ *         verbose - nonzero to list every file
+ */
+static void report(const uint8_t *img, long size, const char *name, int verbose) {
+    const boot_block *boot = (const boot_block *)img;
+    const inode *inodes = (const inode *)(img + BLOCK_SIZE);
+    const uint8_t *data = img + (size_t)(1 + boot->num_inodes) * BLOCK_SIZE;
+    int v2 = boot->magic == FS_V2_MAGIC;
+    uint32_t capacity = v2 ? NUM_DENTRIES + boot->dir_blocks * DENTRIES_PER_BLOCK : NUM_DENTRIES;
+    uint32_t i, b, n, stored, extents, prev, blk;
+    uint32_t regular = 0, file_blocks = 0, meta_blocks = v2 ? boot->dir_blocks : 0, slack = 0;
+    uint32_t total_extents = 0, fragmented = 0, worst = 0, execs = 0, mappable = 0, packed = 0;
+    uint32_t raw_bytes = 0, packed_bytes = 0, sorted = 1;
+    uint8_t *used = calloc(boot->num_inodes, 1);
+    char worst_name[NAME_LEN + 1] = "";
+    const dentry *d, *last = NULL;
+
+    printf("image: %s, %s format, %ld bytes\n", name, v2 ? "extended (v2)" : "original", size);
+    for (i = 0; i < boot->num_entries && i < capacity; i++) {
+        d = (i < NUM_DENTRIES) ? &boot->entries[i]
+            : (const dentry *)(data + (size_t)boot->dir_block[(i - NUM_DENTRIES) / DENTRIES_PER_BLOCK] * BLOCK_SIZE)
+              + (i - NUM_DENTRIES) % DENTRIES_PER_BLOCK;
+        if (last != NULL && strncmp(last->name, d->name, NAME_LEN) > 0) {
+            sorted = 0;
+        }
+        last = d;
+        if (d->type != FILE_TYPE || d->inode >= boot->num_inodes) {
+            continue;
+        }
+        const inode *ino = &inodes[d->inode];
+        regular++;
+        used[d->inode] = 1;
+        stored = ino->length;
+        if (d->flags & DENTRY_LZ4) {
+            /* the end of the offset table is the stream length */
+            uint32_t slot = (ino->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            blk = image_block(img, ino, slot * 4 / BLOCK_SIZE, v2);
+            stored = *(const uint32_t *)(data + (size_t)blk * BLOCK_SIZE + slot * 4 % BLOCK_SIZE);
+            packed++;
+            raw_bytes += ino->length;
+            packed_bytes += stored;
+        }
+        n = (stored + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        file_blocks += n;
+        slack += n * BLOCK_SIZE - stored;
+        if (v2 && n > NUM_DIRECT_V2) {
+            meta_blocks += 1;
+            if (n > NUM_DIRECT_V2 + PTRS_PER_BLOCK) {
+                meta_blocks += 1 + (n - NUM_DIRECT_V2 - PTRS_PER_BLOCK + PTRS_PER_BLOCK - 1) / PTRS_PER_BLOCK;
+            }
+        }
+        extents = 0;
+        prev = 0;
+        for (b = 0; b < n; b++) {
+            blk = image_block(img, ino, b, v2);
+            if (b == 0 || blk != prev + 1) {
+                extents++;
+            }
+            prev = blk;
+        }
+        total_extents += extents;
+        if (extents > 1) {
+            fragmented++;
+        }
+        if (extents > worst) {
+            worst = extents;
+            strncpy(worst_name, d->name, NAME_LEN);
+        }
+        if (n > 0 && !(d->flags & DENTRY_LZ4)) {
+            blk = image_block(img, ino, 0, v2);
+            if (memcmp(data + (size_t)blk * BLOCK_SIZE, ELF_MAGIC, 4) == 0) {
+                execs++;
+                mappable += extents == 1;
+            }
+        }
+        if (verbose) {
+            printf("  %-32.32s inode %3u %8u bytes %5u blocks %3u extents%s\n", d->name, d->inode,
+                   ino->length, n, extents, (d->flags & DENTRY_LZ4) ? " lz4" : "");
+        }
+    }
+    for (i = 0, n = 0; i < boot->num_inodes; i++) {
+        n += used[i];
+    }
+    free(used);
+
+    printf("directory: %u of %u entries, %s\n", boot->num_entries, capacity,
+           sorted ? "sorted by name" : "not sorted");
+    printf("inodes: %u of %u used\n", n, boot->num_inodes);
+    printf("blocks: %u data blocks, %u file data, %u metadata, %u unused\n", boot->num_blocks,
+           file_blocks, meta_blocks, boot->num_blocks - file_blocks - meta_blocks);
+    printf("slack: %u bytes in partially filled blocks (%u.%u%% of file blocks)\n", slack,
+           file_blocks ? (uint32_t)(slack * 100ULL / ((uint64_t)file_blocks * BLOCK_SIZE)) : 0,
+           file_blocks ? (uint32_t)(slack * 1000ULL / ((uint64_t)file_blocks * BLOCK_SIZE) % 10) : 0);
+    printf("fragmentation: %u extents over %u files, %u fragmented", total_extents, regular, fragmented);
+    if (fragmented) {
+        printf(", worst %s with %u extents", worst_name, worst);
+    }
+    printf("\nexecutables: %u raw, %u mappable (contiguous)\n", execs, mappable);
+    printf("compressed: %u files, %u -> %u bytes\n", packed, raw_bytes, packed_bytes);
+}
+
+/* load_image()
+ * Description: Reads a whole image file.
+ * Inputs: path - image to read
+ *         size - filled with its size
+ * Returns: the image, malloc'd
+ */
+static uint8_t *load_image(const char *path, long *size) {
+    FILE *f = fopen(path, "rb");
+    uint8_t *img;
+    if (f == NULL) {
+        die("cannot open", path);
+    }
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    img = malloc(*size);
+    if (fread(img, 1, *size, f) != (size_t)*size) {
+        die("cannot read", path);
+    }
+    fclose(f);
+    return img;
+}
+
+int main(int argc, char **argv) {
+    int sort = 0, compress = 0, v2 = 0, quiet = 0, verbose = 0, analyze = 0, arg = 1;
+    const char *order = NULL;
+    uint32_t num_inodes = 0, i, regular = 0, next;
+    const char *usage = "usage: mkfs [-s | -f order.txt] [-z] [-2] [-i inodes] [-q] [-v] dir out.img\n"
+                        "       mkfs -a [-v] image";
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "-s") == 0) {
+            sort = 1;
+        } else if (strcmp(argv[arg], "-f") == 0 && arg + 1 < argc) {
+            order = argv[++arg];
+        } else if (strcmp(argv[arg], "-z") == 0) {
+            compress = 1;
+        } else if (strcmp(argv[arg], "-2") == 0) {
+            v2 = 1;
+        } else if (strcmp(argv[arg], "-i") == 0 && arg + 1 < argc) {
+            num_inodes = atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "-q") == 0) {
+            quiet = 1;
+        } else if (strcmp(argv[arg], "-v") == 0) {
+            verbose = 1;
+        } else if (strcmp(argv[arg], "-a") == 0) {
+            analyze = 1;
+        } else {
+            die(usage, NULL);
+        }
+    }
+    if (analyze) {
+        long size;
+        uint8_t *img;
+        if (argc - arg != 1) {
+            die(usage, NULL);
+        }
+        img = load_image(argv[arg], &size);
+        report(img, size, argv[arg], verbose);
+        return 0;
+    }
+    if (argc - arg != 2 || (sort && order != NULL)) {
+        die(usage, NULL);
+    }
+
+    /* gather ".", "rtc" and every regular file of the directory */
+    DIR *dir = opendir(argv[arg]);
+    struct dirent *ent;
+    if (dir == NULL) {
+        die("cannot open directory", argv[arg]);
+    }
+    add_special(".", DIR_TYPE);
+    add_special("rtc", RTC_TYPE);
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] != '.') {
+            add_file(argv[arg], ent->d_name);
+        }
+    }
+    closedir(dir);
+
+    for (i = 0; i < num_files; i++) {
+        if (files[i].type != FILE_TYPE) {
+            continue;
+        }
+        regular++;
+        if (files[i].length > (uint64_t)NUM_DATA_BLOCKS * BLOCK_SIZE) {
+            v2 = 1;
+        }
+        if (compress && !files[i].elf) {
+            uint32_t len;
+            uint8_t *stream = lz4_pack(files[i].data, files[i].length, &len);
+            /* not worth it unless it saves a block */
+            if (stream != NULL && (len + BLOCK_SIZE - 1) / BLOCK_SIZE < (files[i].length + BLOCK_SIZE - 1) / BLOCK_SIZE) {
+                files[i].stored = stream;
+                files[i].stored_len = len;
+                files[i].lz4 = 1;
+            } else {
+                free(stream);
+            }
+        }
+    }
+    if (num_files > NUM_DENTRIES) {
+        v2 = 1;
+    }
+    if (num_files > MAX_DENTRIES_V2) {
+        die("too many files", argv[arg]);
+    }
+    if (num_inodes == 0) {
+        num_inodes = regular + 1 > DEFAULT_INODES ? regular + 1 : DEFAULT_INODES;
+    }
+    if (num_inodes < regular + 1) {
+        die("not enough inodes", NULL);
+    }
+
+    /* data goes executables first, inodes are handed out in the same order */
+    qsort(files, num_files, sizeof(file_t), by_default_order);
+    inode *inodes = calloc(num_inodes, sizeof(inode));
+    for (i = 0, next = 1; i < num_files; i++) {
+        if (files[i].type == FILE_TYPE) {
+            files[i].inode = next++;
+            place_file(&files[i], &inodes[files[i].inode], v2);
+        }
+    }
+
+    /* then put the directory in the order lookups want */
+    if (sort) {
+        qsort(files, num_files, sizeof(file_t), by_name);
+    } else if (order != NULL) {
+        read_order(order);
+        qsort(files, num_files, sizeof(file_t), by_rank);
+    }
+    boot_block boot;
+    memset(&boot, 0, sizeof(boot));
+    boot.num_entries = num_files;
+    boot.num_inodes = num_inodes;
+    if (v2) {
+        boot.magic = FS_V2_MAGIC;
+        boot.dir_blocks = (num_files > NUM_DENTRIES) ? (num_files - NUM_DENTRIES + DENTRIES_PER_BLOCK - 1) / DENTRIES_PER_BLOCK : 0;
+        for (i = 0; i < boot.dir_blocks; i++) {
+            boot.dir_block[i] = new_block();
+        }
+    }
+    for (i = 0; i < num_files; i++) {
+        dentry *d = (i < NUM_DENTRIES) ? &boot.entries[i]
+                    : (dentry *)block_ptrs(boot.dir_block[(i - NUM_DENTRIES) / DENTRIES_PER_BLOCK])
+                      + (i - NUM_DENTRIES) % DENTRIES_PER_BLOCK;
+        memcpy(d->name, files[i].name, NAME_LEN);
+        d->type = files[i].type;
+        d->inode = files[i].inode;
+        d->flags = files[i].lz4 ? DENTRY_LZ4 : 0;
+    }
+    boot.num_blocks = num_blocks;
+
+    FILE *f = fopen(argv[arg + 1], "wb");
+    if (f == NULL) {
+        die("cannot create", argv[arg + 1]);
+    }
+    fwrite(&boot, 1, sizeof(boot), f);
+    fwrite(inodes, sizeof(inode), num_inodes, f);
+    fwrite(blocks, BLOCK_SIZE, num_blocks, f);
+    fclose(f);
+
+    if (!quiet) {
+        long size;
+        uint8_t *img = load_image(argv[arg + 1], &size);
+        report(img, size, argv[arg + 1], verbose);
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+/* sosfs.h - on-disk layout of sOS filesystem images, for the host tools
+ * Mirrors student-distrib/filesystem.h, which can't be included here
+ * because the kernel's types.h clashes with <stdint.h>.
+ */
+#ifndef SOSFS_H
+#define SOSFS_H
+
+#include <stdint.h>
+
+#define BLOCK_SIZE 4096
+#define NAME_LEN 32
+#define NUM_DENTRIES 63
+#define NUM_DATA_BLOCKS 1023
+#define RTC_TYPE 0
+#define DIR_TYPE 1
+#define FILE_TYPE 2
+#define DENTRY_LZ4 0x1
+#define FS_V2_MAGIC 0x32534631
+#define NUM_DIRECT_V2 (NUM_DATA_BLOCKS - 2)
+#define SINGLE_INDIRECT (NUM_DATA_BLOCKS - 2)
+#define DOUBLE_INDIRECT (NUM_DATA_BLOCKS - 1)
+#define PTRS_PER_BLOCK (BLOCK_SIZE / 4)
+#define MAX_DIR_BLOCKS 11
+#define DENTRIES_PER_BLOCK (BLOCK_SIZE / 64)
+#define MAX_DENTRIES_V2 (NUM_DENTRIES + MAX_DIR_BLOCKS * DENTRIES_PER_BLOCK)
+
+typedef struct dentry {
+    char name[NAME_LEN];
+    uint32_t type;
+    uint32_t inode;
+    uint32_t flags;
+    uint8_t reserved[20];
+} dentry;
+
+typedef struct boot_block {
+    uint32_t num_entries;
+    uint32_t num_inodes;
+    uint32_t num_blocks;
+    uint32_t magic;          /* FS_V2_MAGIC for extended images            */
+    uint32_t dir_blocks;     /* v2: directory blocks after the boot block  */
+    uint32_t dir_block[MAX_DIR_BLOCKS];
+    dentry entries[NUM_DENTRIES];
+} boot_block;
+
+typedef struct inode {
+    uint32_t length;
+    uint32_t data_block[NUM_DATA_BLOCKS];
+} inode;
+
+#endif